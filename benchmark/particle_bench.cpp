@@ -0,0 +1,190 @@
+// Headless particle_system benchmark. Runs emission, simulation, sorting and instance generation along a synthetic
+// camera path without window and OpenGL context, prints timings as JSON to stdout.
+//
+// particle_bench [--particles N] [--frames N] [--warmup N] [--threads N] [--curl-noise] [--interaction]
+
+#include "particle_system.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+    std::atomic<size_t> allocation_count = 0;
+
+    struct bench_settings {
+        size_t particle_count = 100000;
+        size_t frame_count = 600;
+        size_t warmup_frame_count = 60;
+        size_t thread_count = 0;
+        bool curl_noise_enabled = false;
+        bool interaction_enabled = false;
+    };
+
+    bool parse_settings(int argc, char* argv[], bench_settings& settings) noexcept {
+        for (int i = 1; i < argc; ++i) {
+            const bool has_value = i + 1 < argc;
+
+            if (strcmp(argv[i], "--particles") == 0 && has_value) {
+                settings.particle_count = std::strtoull(argv[++i], nullptr, 10);
+            } else if (strcmp(argv[i], "--frames") == 0 && has_value) {
+                settings.frame_count = std::strtoull(argv[++i], nullptr, 10);
+            } else if (strcmp(argv[i], "--warmup") == 0 && has_value) {
+                settings.warmup_frame_count = std::strtoull(argv[++i], nullptr, 10);
+            } else if (strcmp(argv[i], "--threads") == 0 && has_value) {
+                settings.thread_count = std::strtoull(argv[++i], nullptr, 10);
+            } else if (strcmp(argv[i], "--curl-noise") == 0) {
+                settings.curl_noise_enabled = true;
+            } else if (strcmp(argv[i], "--interaction") == 0) {
+                settings.interaction_enabled = true;
+            } else {
+                fprintf(stderr, "unknown argument: %s\n", argv[i]);
+                return false;
+            }
+        }
+
+        return settings.particle_count > 0 && settings.frame_count > 0;
+    }
+
+    // NOTE: camera orbits the emitter and bobs up and down, so particles enter and leave the frustum
+    camera get_path_camera(float time) noexcept {
+        const float angle = time * 0.5f;
+        const glm::vec3 position(std::cos(angle) * 8.0f, 2.0f + std::sin(time * 0.3f) * 1.5f, std::sin(angle) * 8.0f);
+        return camera(position, glm::vec3(0.0f, 2.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), 45.0f, 1.0f, 1.0f);
+    }
+
+    double get_percentile(const std::vector<double>& sorted_values, double percentile) noexcept {
+        const size_t index = static_cast<size_t>(percentile * static_cast<double>(sorted_values.size()));
+        return sorted_values[std::min(index, sorted_values.size() - 1)];
+    }
+}
+
+void* operator new(size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size != 0 ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    std::free(memory);
+}
+
+int main(int argc, char* argv[]) {
+    bench_settings settings;
+    if (!parse_settings(argc, argv, settings)) {
+        fprintf(stderr, "usage: particle_bench [--particles N] [--frames N] [--warmup N] [--threads N] [--curl-noise] [--interaction]\n");
+        return 1;
+    }
+
+    thread_pool pool;
+    if (settings.thread_count > 0) {
+        pool.create(settings.thread_count);
+    }
+
+    particle_system system(settings.particle_count, particle_system::backend::HEADLESS);
+    system.set_thread_pool(settings.thread_count > 0 ? &pool : nullptr);
+    system.set_distance_lod(15.0f, 0.25f);
+
+    const curl_noise turbulence(1.5f, 2);
+    if (settings.curl_noise_enabled) {
+        system.set_curl_noise(&turbulence, 0.8f);
+    }
+
+    if (settings.interaction_enabled) {
+        particle_interaction interaction;
+        interaction.radius = 0.15f;
+        interaction.separation = 0.5f;
+        interaction.pressure = 0.05f;
+        interaction.rest_density = 4.0f;
+        system.set_particle_interaction(interaction);
+    }
+
+    particle_props props;
+    props.position = glm::vec3(0.0f);
+    props.velocity = glm::vec3(0.0f, 2.0f, 0.0f);
+    props.velocity_variation = glm::vec3(1.5f, 1.0f, 1.5f);
+    props.start_color = glm::vec4(1.0f, 0.5f, 0.2f, 1.0f);
+    props.end_color = glm::vec4(0.2f, 0.2f, 0.2f, 0.0f);
+    props.start_size = 0.1f;
+    props.end_size = 0.4f;
+    props.size_variation = 0.05f;
+    props.life_time = 2.0f;
+
+    // NOTE: the pool is kept nearly full in the steady state
+    particle_emitter emitter(props, static_cast<float>(settings.particle_count) / props.life_time);
+
+    std::vector<particle_instance> instances(settings.particle_count);
+
+    const float dt = 1.0f / 60.0f;
+    const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+
+    std::vector<double> frame_times_ns;
+    frame_times_ns.reserve(settings.frame_count);
+
+    size_t processed_particle_count = 0;
+    size_t drawn_particle_count = 0;
+    size_t measured_allocation_count = 0;
+
+    for (size_t frame = 0; frame < settings.warmup_frame_count + settings.frame_count; ++frame) {
+        const camera frame_camera = get_path_camera(static_cast<float>(frame) * dt);
+        const frustum view_frustum(projection * frame_camera.get_view());
+
+        const size_t allocations_before = allocation_count.load(std::memory_order_relaxed);
+        const auto begin = std::chrono::steady_clock::now();
+
+        emitter.update(dt, system);
+        system.simulate(dt, frame_camera, &view_frustum);
+        system.write_instances(instances.data());
+
+        const auto end = std::chrono::steady_clock::now();
+        const size_t allocations_after = allocation_count.load(std::memory_order_relaxed);
+
+        if (frame < settings.warmup_frame_count) {
+            continue;
+        }
+
+        frame_times_ns.emplace_back(static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()));
+        measured_allocation_count += allocations_after - allocations_before;
+        processed_particle_count += system.get_live_count();
+        drawn_particle_count += system.get_instance_count();
+    }
+
+    double total_time_ns = 0.0;
+    for (double time : frame_times_ns) {
+        total_time_ns += time;
+    }
+
+    std::sort(frame_times_ns.begin(), frame_times_ns.end());
+
+    const double frame_count = static_cast<double>(settings.frame_count);
+
+    printf("{\n");
+    printf("  \"particles\": %zu,\n", settings.particle_count);
+    printf("  \"frames\": %zu,\n", settings.frame_count);
+    printf("  \"threads\": %zu,\n", settings.thread_count);
+    printf("  \"curl_noise\": %s,\n", settings.curl_noise_enabled ? "true" : "false");
+    printf("  \"interaction\": %s,\n", settings.interaction_enabled ? "true" : "false");
+    printf("  \"mean_live_particles\": %.1f,\n", static_cast<double>(processed_particle_count) / frame_count);
+    printf("  \"mean_drawn_particles\": %.1f,\n", static_cast<double>(drawn_particle_count) / frame_count);
+    printf("  \"ns_per_particle\": %.3f,\n", processed_particle_count > 0 ? total_time_ns / static_cast<double>(processed_particle_count) : 0.0);
+    printf("  \"allocations_per_frame\": %.3f,\n", static_cast<double>(measured_allocation_count) / frame_count);
+    printf("  \"update_ms\": { \"mean\": %.4f, \"p50\": %.4f, \"p99\": %.4f, \"max\": %.4f }\n",
+        total_time_ns / frame_count * 1e-6, get_percentile(frame_times_ns, 0.5) * 1e-6, get_percentile(frame_times_ns, 0.99) * 1e-6, frame_times_ns.back() * 1e-6);
+    printf("}\n");
+
+    return 0;
+}
@@ -0,0 +1,19 @@
+#version 460 core
+
+uniform sampler2D u_scene_depth;
+uniform int u_downsample;
+
+void main() {
+	const ivec2 first_texel = ivec2(gl_FragCoord.xy) * u_downsample;
+	const ivec2 max_texel = textureSize(u_scene_depth, 0) - 1;
+
+	// NOTE: the farthest depth lets particles cover the whole block, the upsample discards them over nearer texels
+	float depth = 0.0f;
+	for (int y = 0; y < u_downsample; ++y) {
+		for (int x = 0; x < u_downsample; ++x) {
+			depth = max(depth, texelFetch(u_scene_depth, min(first_texel + ivec2(x, y), max_texel), 0).r);
+		}
+	}
+
+	gl_FragDepth = depth;
+}
@@ -0,0 +1,50 @@
+#version 460 core
+
+out vec4 frag_color;
+
+uniform sampler2D u_particles;
+uniform sampler2D u_low_res_depth;
+uniform sampler2D u_scene_depth;
+
+uniform int u_downsample;
+uniform vec2 u_depth_range;
+
+float linearize_depth(float depth) {
+	const float near = u_depth_range.x;
+	const float far = u_depth_range.y;
+	return 2.0f * near * far / (far + near - (depth * 2.0f - 1.0f) * (far - near));
+}
+
+void main() {
+	const float depth = linearize_depth(texelFetch(u_scene_depth, ivec2(gl_FragCoord.xy), 0).r);
+
+	// NOTE: position in low resolution texels relative to the centers of the 4 nearest ones
+	const vec2 low_res_position = gl_FragCoord.xy / float(u_downsample) - 0.5f;
+	const ivec2 base_texel = ivec2(floor(low_res_position));
+	const vec2 bilinear = fract(low_res_position);
+	const ivec2 max_texel = textureSize(u_particles, 0) - 1;
+
+	vec4 color = vec4(0.0f);
+	float total_weight = 0.0f;
+
+	for (int y = 0; y < 2; ++y) {
+		for (int x = 0; x < 2; ++x) {
+			const ivec2 texel = clamp(base_texel + ivec2(x, y), ivec2(0), max_texel);
+			const float low_res_depth = linearize_depth(texelFetch(u_low_res_depth, texel, 0).r);
+
+			// NOTE: relative difference, so that the same tolerance works near and far from the camera
+			const float depth_weight = 1.0f / (1e-3f + abs(depth - low_res_depth) / depth);
+			const float weight = (x == 0 ? 1.0f - bilinear.x : bilinear.x) * (y == 0 ? 1.0f - bilinear.y : bilinear.y) * depth_weight;
+
+			color += texelFetch(u_particles, texel, 0) * weight;
+			total_weight += weight;
+		}
+	}
+
+	color /= max(total_weight, 1e-6f);
+	if (color.a <= 0.0f) {
+		discard;
+	}
+
+	frag_color = color;
+}
@@ -0,0 +1,22 @@
+#version 460 core
+
+out vec4 frag_color;
+
+uniform sampler2D u_accumulation;
+uniform sampler2D u_revealage;
+
+void main() {
+	const ivec2 texel = ivec2(gl_FragCoord.xy);
+
+	const float revealage = texelFetch(u_revealage, texel, 0).r;
+	if (revealage >= 1.0f) {
+		discard;
+	}
+
+	const vec4 accumulation = texelFetch(u_accumulation, texel, 0);
+	
+	// NOTE: clamping keeps the division finite when 16-bit float accumulation saturates
+	const vec3 average_color = accumulation.rgb / clamp(accumulation.a, 1e-4f, 5e4f);
+
+	frag_color = vec4(average_color, 1.0f - revealage);
+}
@@ -0,0 +1,7 @@
+#version 460 core
+
+layout (location = 0) in vec3 a_position;
+
+void main() {
+	gl_Position = vec4(a_position, 1.0f);
+}
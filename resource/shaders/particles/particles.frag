@@ -7,13 +7,16 @@ in VS_OUT {
 	vec2 texcoord1;
 	vec2 texcoord2;
 	float blend;
+	flat uint layer;
 } fs_in;
 
-uniform sampler2D u_atlas;
+uniform sampler2DArray u_atlas;
 
 void main() {
-	const vec4 color1 = texture(u_atlas, fs_in.texcoord1);
-	const vec4 color2 = texture(u_atlas, fs_in.texcoord2);
+	const vec4 color1 = texture(u_atlas, vec3(fs_in.texcoord1, fs_in.layer));
+	const vec4 color2 = texture(u_atlas, vec3(fs_in.texcoord2, fs_in.layer));
 	frag_color = mix(color1, color2, fs_in.blend);
+	// NOTE: instance alpha fades particles over their life and compensates the opacity of the ones thinned out by LOD and budget
+	frag_color.a *= fs_in.color.a;
 	// frag_color.rgb = mix(frag_color.rgb, fs_in.color.rgb, 0.5f);
 }
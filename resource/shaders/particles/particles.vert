@@ -8,33 +8,63 @@ out VS_OUT {
 	vec2 texcoord1;
 	vec2 texcoord2;
 	float blend;
+	flat uint layer;
 } vs_out;
 
+#define MAX_ATLAS_LAYERS 8
+
 uniform mat4 u_proj_view;
-uniform vec2 u_atlas_size = vec2(8);
+// NOTE: per atlas layer tiles count and part of the layer covered by the atlas image
+uniform vec2 u_atlas_sizes[MAX_ATLAS_LAYERS];
+uniform vec2 u_layer_uv_scales[MAX_ATLAS_LAYERS] = vec2[](vec2(1), vec2(1), vec2(1), vec2(1), vec2(1), vec2(1), vec2(1), vec2(1));
 
-layout(std140, binding = 0) buffer InstancesTransform {
-    mat4 u_model[];
-};
+uniform vec3 u_camera_position;
+uniform vec3 u_camera_forward;
+uniform vec3 u_camera_right;
+uniform vec3 u_camera_up;
 
-layout(std140, binding = 1) buffer InstancesColor {
-    vec4 u_color[];
+struct ParticleInstance {
+	vec3 position;
+	float size;
+	float rotation;
+	uint color;
+	uint frame;
+	float blend;
 };
 
-layout(std140, binding = 2) buffer InstancesOffset {
-    vec4 u_offset[];
+layout(std430, binding = 0) readonly buffer Instances {
+	ParticleInstance u_instances[];
 };
 
-layout(std140, binding = 3) buffer InstancesBlendFactor {
-    float u_blend[];
-};
+vec2 tile_offset(uint tile, vec2 atlas_size) {
+	const uint tiles_in_raw = uint(atlas_size.x);
+	return vec2(tile % tiles_in_raw, tile / tiles_in_raw) / atlas_size;
+}
 
 void main() {
-	vs_out.color = u_color[gl_InstanceID];
-	vs_out.texcoord1 = u_offset[gl_InstanceID].xy + a_texcoord / u_atlas_size;
-	vs_out.texcoord2 = u_offset[gl_InstanceID].zw + a_texcoord / u_atlas_size;
+	const ParticleInstance instance = u_instances[gl_InstanceID];
+
+	const uint layer = instance.frame >> 16;
+	const uint frame = instance.frame & 0xFFFF;
 
-	vs_out.blend = 1.0f - u_blend[gl_InstanceID];
+	const vec2 atlas_size = max(u_atlas_sizes[layer], vec2(1.0f));
+	const vec2 uv_scale = u_layer_uv_scales[layer];
+	const uint last_tile = uint(atlas_size.x * atlas_size.y) - 1;
+
+	vs_out.color = unpackUnorm4x8(instance.color);
+	vs_out.texcoord1 = (tile_offset(frame, atlas_size) + a_texcoord / atlas_size) * uv_scale;
+	vs_out.texcoord2 = (tile_offset(min(frame + 1, last_tile), atlas_size) + a_texcoord / atlas_size) * uv_scale;
+	vs_out.layer = layer;
+
+	vs_out.blend = 1.0f - instance.blend;
+
+	const float c = cos(instance.rotation), s = sin(instance.rotation);
+	const vec2 corner = mat2(c, s, -s, c) * a_position.xy * instance.size;
+
+	const vec3 particle_to_camera = normalize(u_camera_position - instance.position);
+	const float bias = max(1.0f - dot(u_camera_forward, particle_to_camera), 0.1f);
 	
-	gl_Position = u_proj_view * u_model[gl_InstanceID] * vec4(a_position, 1.0f);
-}
\ No newline at end of file
+	const vec3 position = instance.position + particle_to_camera * bias + u_camera_right * corner.x + u_camera_up * corner.y;
+
+	gl_Position = u_proj_view * vec4(position, 1.0f);
+}
@@ -0,0 +1,32 @@
+#version 460 core
+
+layout (location = 0) out vec4 accumulation;
+layout (location = 1) out float revealage;
+
+in VS_OUT {
+	vec4 color;
+	vec2 texcoord1;
+	vec2 texcoord2;
+	float blend;
+	flat uint layer;
+} fs_in;
+
+uniform sampler2DArray u_atlas;
+
+// Depth weight from "Weighted Blended Order-Independent Transparency" (McGuire, Bavoil), eq. 10 adapted for window space depth
+float weight(float alpha, float depth) {
+	return clamp(pow(min(1.0f, alpha * 10.0f) + 0.01f, 3.0f) * 1e8f * pow(1.0f - depth * 0.9f, 3.0f), 1e-2f, 3e3f);
+}
+
+void main() {
+	const vec4 color1 = texture(u_atlas, vec3(fs_in.texcoord1, fs_in.layer));
+	const vec4 color2 = texture(u_atlas, vec3(fs_in.texcoord2, fs_in.layer));
+	vec4 color = mix(color1, color2, fs_in.blend);
+	// NOTE: see particles.frag
+	color.a *= fs_in.color.a;
+
+	const float w = weight(color.a, gl_FragCoord.z);
+
+	accumulation = vec4(color.rgb * color.a, color.a) * w;
+	revealage = color.a;
+}
@@ -22,6 +22,14 @@ struct CascadedShadowmap {
     float cascade_end_z[CASCADE_COUNT];
 };
 
+uniform mat4 u_model;
+
+// NOTE: full resolution normals are lit per fragment, so that coarse LOD levels keep the lighting of the details they don't have
+uniform sampler2D u_normal_map;
+uniform vec2 u_terrain_size;
+// NOTE: streamed terrain has no normal map, its normals are interpolated from the vertices
+uniform bool u_per_vertex_normals = false;
+
 uniform struct DirectionalLight {
     vec3 direction;
     vec3 color;
@@ -106,8 +114,16 @@ float region_percent(int tile) {
     return percent;
 }
 
+vec3 sample_normal() {
+    const vec2 xz = texture(u_normal_map, (fs_in.frag_pos_localspace.xz + 0.5f) / u_terrain_size).rg;
+    const vec3 local_normal = vec3(xz.x, sqrt(max(1.0f - dot(xz, xz), 0.0f)), xz.y);
+
+    // NOTE: terrain model matrix keeps uniform scale
+    return normalize(mat3(u_model) * local_normal);
+}
+
 void main() {
-    const vec3 normal = normalize(fs_in.normal);
+    const vec3 normal = u_per_vertex_normals ? normalize(fs_in.normal) : sample_normal();
     const vec3 light_direction = normalize(-u_light.direction);
 
     float shadow = 0.0f;
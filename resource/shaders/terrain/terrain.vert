@@ -1,15 +1,16 @@
 #version 460 core
 
-layout(location = 0) in vec3 a_position;
-layout(location = 1) in vec3 a_normal;
-layout(location = 2) in vec2 a_texcoord;
-
 
 const uint CASCADE_COUNT = 3;
+const uint MAX_LOD_COUNT = 16;
+// NOTE: matches terrain::PATCH_SIZE
+const int PATCH_SIZE = 32;
+
 out VS_OUT {
     vec3 frag_pos_localspace;
     vec3 frag_pos_worldspace;
     vec4 frag_pos_clipspace;
+    // NOTE: used by terrain_streamed.vert only, see u_per_vertex_normals in terrain.frag
     vec3 normal;
     vec2 texcoord;
 
@@ -18,9 +19,22 @@ out VS_OUT {
     vec4 frag_pos_light_clipspace[CASCADE_COUNT];
 } vs_out;
 
+// xy - patch origin in height map texels, z - distance between patch vertices in texels, w - LOD level
+layout(std430, binding = 0) readonly buffer Patches {
+    vec4 patches[];
+};
+
 uniform mat4 u_model, u_view, u_projection;
 uniform mat4 u_light_space[CASCADE_COUNT];
 
+uniform sampler2D u_height_map;
+uniform vec2 u_terrain_size;
+uniform vec2 u_height_range;
+uniform float u_dudv;
+
+uniform vec3 u_camera_localspace;
+uniform vec2 u_morph_ranges[MAX_LOD_COUNT];
+
 uniform struct Fog {
     vec3 color;
     
@@ -30,13 +44,34 @@ uniform struct Fog {
 
 uniform vec4 u_water_clip_plane;
 
+float sample_height(vec2 position) {
+    return mix(u_height_range.x, u_height_range.y, texture(u_height_map, (position + 0.5f) / u_terrain_size).r);
+}
+
+vec2 get_patch_position(vec4 patch_data, vec2 grid) {
+    return min(patch_data.xy + grid * patch_data.z, u_terrain_size - 1.0f);
+}
+
 void main() {
-    const mat3 normal_matrix = transpose(inverse(mat3(u_model)));
+    const vec4 patch_data = patches[gl_InstanceID];
+
+    // NOTE: odd vertices slide onto their even neighbours, so that the grid turns into the grid of the next LOD level
+    vec2 grid = vec2(gl_VertexID % (PATCH_SIZE + 1), gl_VertexID / (PATCH_SIZE + 1));
+    vec2 position = get_patch_position(patch_data, grid);
+
+    const float distance_to_camera = distance(u_camera_localspace, vec3(position.x, sample_height(position), position.y));
+    const vec2 morph_range = u_morph_ranges[uint(patch_data.w)];
+    const float morph = clamp((distance_to_camera - morph_range.x) / max(morph_range.y - morph_range.x, 1e-4f), 0.0f, 1.0f);
+
+    grid -= fract(grid * 0.5f) * 2.0f * morph;
+    position = get_patch_position(patch_data, grid);
+
+    const vec3 local_position = vec3(position.x, sample_height(position), position.y);
 
-    vs_out.frag_pos_localspace = a_position;
-    vs_out.frag_pos_worldspace = vec3(u_model * vec4(a_position, 1.0f));
-    vs_out.normal = normalize(normal_matrix * a_normal);
-    vs_out.texcoord = a_texcoord;
+    vs_out.frag_pos_localspace = local_position;
+    vs_out.frag_pos_worldspace = vec3(u_model * vec4(local_position, 1.0f));
+    vs_out.normal = vec3(0.0f, 1.0f, 0.0f);
+    vs_out.texcoord = vec2(position.x, u_terrain_size.y - 1.0f - position.y) * u_dudv;
 
     for (uint i = 0; i < CASCADE_COUNT; ++i) {
         vs_out.frag_pos_light_clipspace[i] = u_light_space[i] * vec4(vs_out.frag_pos_worldspace, 1.0f);
@@ -52,4 +87,4 @@ void main() {
 
     vs_out.frag_pos_clipspace = u_projection * frag_pos_view_space;
     gl_Position = vs_out.frag_pos_clipspace;
-}
\ No newline at end of file
+}
@@ -0,0 +1,100 @@
+#version 460 core
+
+
+const uint CASCADE_COUNT = 3;
+const uint MAX_LOD_COUNT = 16;
+
+out VS_OUT {
+    vec3 frag_pos_localspace;
+    vec3 frag_pos_worldspace;
+    vec4 frag_pos_clipspace;
+    vec3 normal;
+    vec2 texcoord;
+
+    float visibility;
+
+    vec4 frag_pos_light_clipspace[CASCADE_COUNT];
+} vs_out;
+
+// xy - piece origin in height map texels, z - distance between piece vertices in texels, w - piece type * MAX_LOD_COUNT + clipmap level
+layout(std430, binding = 0) readonly buffer Patches {
+    vec4 patches[];
+};
+
+uniform mat4 u_model, u_view, u_projection;
+uniform mat4 u_light_space[CASCADE_COUNT];
+
+// NOTE: layer L keeps u_clipmap_size^2 samples of level L, sample c of the level is stored in texel c mod u_clipmap_size
+uniform sampler2DArray u_clipmap;
+uniform float u_clipmap_size;
+// NOTE: origins of the levels in texels and the width of the morph area in level quads
+uniform vec2 u_level_origins[MAX_LOD_COUNT];
+uniform float u_morph_width;
+// NOTE: vertices per row of the drawn piece, vertex i is at (i % u_grid_width, i / u_grid_width)
+uniform int u_grid_width;
+uniform vec2 u_terrain_size;
+uniform vec2 u_height_range;
+uniform float u_dudv;
+
+uniform struct Fog {
+    vec3 color;
+    
+    float density;
+    float gradient;
+} u_fog;
+
+uniform vec4 u_water_clip_plane;
+
+float sample_height(vec2 sample_index, float level) {
+    const float height = texture(u_clipmap, vec3((sample_index + 0.5f) / u_clipmap_size, level)).r;
+    return mix(u_height_range.x, u_height_range.y, height);
+}
+
+void main() {
+    const vec4 patch_data = patches[gl_BaseInstance + gl_InstanceID];
+    const float spacing = patch_data.z;
+    const uint level = uint(patch_data.w) % MAX_LOD_COUNT;
+
+    const vec2 grid = vec2(gl_VertexID % u_grid_width, gl_VertexID / u_grid_width);
+    vec2 sample_index = patch_data.xy / spacing + grid;
+
+    // NOTE: odd vertices slide onto their even neighbours near the outer edge of the level, so that the edge matches the next level grid
+    const vec2 first_sample = u_level_origins[level] / spacing;
+    const float half_size = (u_clipmap_size - 1.0f) * 0.5f;
+    const vec2 center_distance = abs(sample_index - first_sample - half_size);
+    const float morph = clamp((max(center_distance.x, center_distance.y) - (half_size - u_morph_width - 1.0f)) / u_morph_width, 0.0f, 1.0f);
+
+    sample_index -= fract(sample_index * 0.5f) * 2.0f * morph;
+
+    // NOTE: central differences with the level spacing, neighbours of the edge samples are clamped to the level
+    const vec2 last_sample = first_sample + u_clipmap_size - 1.0f;
+    const float left = sample_height(max(sample_index - vec2(1.0f, 0.0f), first_sample), level);
+    const float right = sample_height(min(sample_index + vec2(1.0f, 0.0f), last_sample), level);
+    const float back = sample_height(max(sample_index - vec2(0.0f, 1.0f), first_sample), level);
+    const float front = sample_height(min(sample_index + vec2(0.0f, 1.0f), last_sample), level);
+    const vec3 local_normal = normalize(vec3(left - right, 2.0f * spacing, back - front));
+
+    const vec2 position = clamp(sample_index * spacing, vec2(0.0f), u_terrain_size - 1.0f);
+    const vec3 local_position = vec3(position.x, sample_height(sample_index, level), position.y);
+
+    vs_out.frag_pos_localspace = local_position;
+    vs_out.frag_pos_worldspace = vec3(u_model * vec4(local_position, 1.0f));
+    // NOTE: terrain model matrix keeps uniform scale
+    vs_out.normal = normalize(mat3(u_model) * local_normal);
+    vs_out.texcoord = vec2(position.x, u_terrain_size.y - 1.0f - position.y) * u_dudv;
+
+    for (uint i = 0; i < CASCADE_COUNT; ++i) {
+        vs_out.frag_pos_light_clipspace[i] = u_light_space[i] * vec4(vs_out.frag_pos_worldspace, 1.0f);
+    }
+    
+    const vec4 frag_pos_view_space = u_view * vec4(vs_out.frag_pos_worldspace, 1.0f);
+
+    gl_ClipDistance[0] = dot(u_water_clip_plane, vec4(vs_out.frag_pos_localspace, 1.0f));
+
+    float distance = length(frag_pos_view_space.xyz);
+    vs_out.visibility = exp(-pow(distance * u_fog.density, u_fog.gradient));
+    vs_out.visibility = clamp(vs_out.visibility, 0.0f, 1.0f);
+
+    vs_out.frag_pos_clipspace = u_projection * frag_pos_view_space;
+    gl_Position = vs_out.frag_pos_clipspace;
+}
@@ -0,0 +1,43 @@
+#version 460 core
+
+const uint MAX_LOD_COUNT = 16;
+
+// xy - piece origin in height map texels, z - distance between piece vertices in texels, w - piece type * MAX_LOD_COUNT + clipmap level
+layout(std430, binding = 0) readonly buffer Patches {
+    vec4 patches[];
+};
+
+uniform mat4 u_model, u_view, u_projection;
+
+uniform sampler2DArray u_clipmap;
+uniform float u_clipmap_size;
+uniform vec2 u_level_origins[MAX_LOD_COUNT];
+uniform float u_morph_width;
+uniform int u_grid_width;
+uniform vec2 u_terrain_size;
+uniform vec2 u_height_range;
+
+float sample_height(vec2 sample_index, float level) {
+    const float height = texture(u_clipmap, vec3((sample_index + 0.5f) / u_clipmap_size, level)).r;
+    return mix(u_height_range.x, u_height_range.y, height);
+}
+
+void main() {
+    const vec4 patch_data = patches[gl_BaseInstance + gl_InstanceID];
+    const float spacing = patch_data.z;
+    const uint level = uint(patch_data.w) % MAX_LOD_COUNT;
+
+    // NOTE: morphs exactly as terrain_clipmap.vert does, otherwise the terrain would shadow itself where the two surfaces differ
+    const vec2 grid = vec2(gl_VertexID % u_grid_width, gl_VertexID / u_grid_width);
+    vec2 sample_index = patch_data.xy / spacing + grid;
+
+    const vec2 first_sample = u_level_origins[level] / spacing;
+    const float half_size = (u_clipmap_size - 1.0f) * 0.5f;
+    const vec2 center_distance = abs(sample_index - first_sample - half_size);
+    const float morph = clamp((max(center_distance.x, center_distance.y) - (half_size - u_morph_width - 1.0f)) / u_morph_width, 0.0f, 1.0f);
+
+    sample_index -= fract(sample_index * 0.5f) * 2.0f * morph;
+
+    const vec2 position = clamp(sample_index * spacing, vec2(0.0f), u_terrain_size - 1.0f);
+    gl_Position = u_projection * u_view * u_model * vec4(position.x, sample_height(sample_index, level), position.y, 1.0f);
+}
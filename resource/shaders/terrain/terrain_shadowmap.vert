@@ -0,0 +1,44 @@
+#version 460 core
+
+const uint MAX_LOD_COUNT = 16;
+// NOTE: matches terrain::PATCH_SIZE
+const int PATCH_SIZE = 32;
+
+// xy - patch origin in height map texels, z - distance between patch vertices in texels, w - LOD level
+layout(std430, binding = 0) readonly buffer Patches {
+    vec4 patches[];
+};
+
+uniform mat4 u_model, u_view, u_projection;
+
+uniform sampler2D u_height_map;
+uniform vec2 u_terrain_size;
+uniform vec2 u_height_range;
+
+uniform vec3 u_camera_localspace;
+uniform vec2 u_morph_ranges[MAX_LOD_COUNT];
+
+float sample_height(vec2 position) {
+    return mix(u_height_range.x, u_height_range.y, texture(u_height_map, (position + 0.5f) / u_terrain_size).r);
+}
+
+vec2 get_patch_position(vec4 patch_data, vec2 grid) {
+    return min(patch_data.xy + grid * patch_data.z, u_terrain_size - 1.0f);
+}
+
+void main() {
+    const vec4 patch_data = patches[gl_InstanceID];
+
+    // NOTE: morphs exactly as terrain.vert does, otherwise the terrain would shadow itself where the two surfaces differ
+    vec2 grid = vec2(gl_VertexID % (PATCH_SIZE + 1), gl_VertexID / (PATCH_SIZE + 1));
+    vec2 position = get_patch_position(patch_data, grid);
+
+    const float distance_to_camera = distance(u_camera_localspace, vec3(position.x, sample_height(position), position.y));
+    const vec2 morph_range = u_morph_ranges[uint(patch_data.w)];
+    const float morph = clamp((distance_to_camera - morph_range.x) / max(morph_range.y - morph_range.x, 1e-4f), 0.0f, 1.0f);
+
+    grid -= fract(grid * 0.5f) * 2.0f * morph;
+    position = get_patch_position(patch_data, grid);
+
+    gl_Position = u_projection * u_view * u_model * vec4(position.x, sample_height(position), position.y, 1.0f);
+}
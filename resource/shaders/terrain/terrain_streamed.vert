@@ -0,0 +1,110 @@
+#version 460 core
+
+
+const uint CASCADE_COUNT = 3;
+const uint MAX_LOD_COUNT = 16;
+// NOTE: matches terrain::PATCH_SIZE
+const int PATCH_SIZE = 32;
+// NOTE: match terrain_pyramid::TILE_QUADS and TILE_BORDER
+const float TILE_QUADS = 64.0f;
+const float TILE_BORDER = 1.0f;
+
+out VS_OUT {
+    vec3 frag_pos_localspace;
+    vec3 frag_pos_worldspace;
+    vec4 frag_pos_clipspace;
+    vec3 normal;
+    vec2 texcoord;
+
+    float visibility;
+
+    vec4 frag_pos_light_clipspace[CASCADE_COUNT];
+} vs_out;
+
+// xy - patch origin in height map texels, z - distance between patch vertices in texels, w - slot of the tile * MAX_LOD_COUNT + LOD level
+layout(std430, binding = 0) readonly buffer Patches {
+    vec4 patches[];
+};
+
+uniform mat4 u_model, u_view, u_projection;
+uniform mat4 u_light_space[CASCADE_COUNT];
+
+// NOTE: layer of every slot keeps TILE_QUADS + 1 samples of its tile with TILE_BORDER samples on each side
+uniform sampler2DArray u_tiles;
+uniform vec2 u_terrain_size;
+uniform vec2 u_height_range;
+uniform float u_dudv;
+
+uniform vec3 u_camera_localspace;
+uniform vec2 u_morph_ranges[MAX_LOD_COUNT];
+
+uniform struct Fog {
+    vec3 color;
+    
+    float density;
+    float gradient;
+} u_fog;
+
+uniform vec4 u_water_clip_plane;
+
+float sample_height(vec4 patch_data, vec2 position) {
+    const float spacing = patch_data.z;
+    const float tile_span = TILE_QUADS * spacing;
+    const vec2 tile_origin = floor(patch_data.xy / tile_span) * tile_span;
+
+    const vec2 sample_coord = (position - tile_origin) / spacing + TILE_BORDER;
+    const float layer = floor(patch_data.w / MAX_LOD_COUNT);
+    const float height = texture(u_tiles, vec3((sample_coord + 0.5f) / textureSize(u_tiles, 0).xy, layer)).r;
+
+    return mix(u_height_range.x, u_height_range.y, height);
+}
+
+vec2 get_patch_position(vec4 patch_data, vec2 grid) {
+    return min(patch_data.xy + grid * patch_data.z, u_terrain_size - 1.0f);
+}
+
+void main() {
+    const vec4 patch_data = patches[gl_InstanceID];
+
+    // NOTE: odd vertices slide onto their even neighbours, so that the grid turns into the grid of the next LOD level
+    vec2 grid = vec2(gl_VertexID % (PATCH_SIZE + 1), gl_VertexID / (PATCH_SIZE + 1));
+    vec2 position = get_patch_position(patch_data, grid);
+
+    const float distance_to_camera = distance(u_camera_localspace, vec3(position.x, sample_height(patch_data, position), position.y));
+    const vec2 morph_range = u_morph_ranges[uint(patch_data.w) % MAX_LOD_COUNT];
+    const float morph = clamp((distance_to_camera - morph_range.x) / max(morph_range.y - morph_range.x, 1e-4f), 0.0f, 1.0f);
+
+    grid -= fract(grid * 0.5f) * 2.0f * morph;
+    position = get_patch_position(patch_data, grid);
+
+    // NOTE: central differences with the tile spacing, borders of tiles hold the neighbours of their edge samples
+    const float spacing = patch_data.z;
+    const float left = sample_height(patch_data, position - vec2(spacing, 0.0f));
+    const float right = sample_height(patch_data, position + vec2(spacing, 0.0f));
+    const float back = sample_height(patch_data, position - vec2(0.0f, spacing));
+    const float front = sample_height(patch_data, position + vec2(0.0f, spacing));
+    const vec3 local_normal = normalize(vec3(left - right, 2.0f * spacing, back - front));
+
+    const vec3 local_position = vec3(position.x, sample_height(patch_data, position), position.y);
+
+    vs_out.frag_pos_localspace = local_position;
+    vs_out.frag_pos_worldspace = vec3(u_model * vec4(local_position, 1.0f));
+    // NOTE: terrain model matrix keeps uniform scale
+    vs_out.normal = normalize(mat3(u_model) * local_normal);
+    vs_out.texcoord = vec2(position.x, u_terrain_size.y - 1.0f - position.y) * u_dudv;
+
+    for (uint i = 0; i < CASCADE_COUNT; ++i) {
+        vs_out.frag_pos_light_clipspace[i] = u_light_space[i] * vec4(vs_out.frag_pos_worldspace, 1.0f);
+    }
+    
+    const vec4 frag_pos_view_space = u_view * vec4(vs_out.frag_pos_worldspace, 1.0f);
+
+    gl_ClipDistance[0] = dot(u_water_clip_plane, vec4(vs_out.frag_pos_localspace, 1.0f));
+
+    float distance = length(frag_pos_view_space.xyz);
+    vs_out.visibility = exp(-pow(distance * u_fog.density, u_fog.gradient));
+    vs_out.visibility = clamp(vs_out.visibility, 0.0f, 1.0f);
+
+    vs_out.frag_pos_clipspace = u_projection * frag_pos_view_space;
+    gl_Position = vs_out.frag_pos_clipspace;
+}
@@ -0,0 +1,55 @@
+#version 460 core
+
+const uint MAX_LOD_COUNT = 16;
+// NOTE: matches terrain::PATCH_SIZE
+const int PATCH_SIZE = 32;
+// NOTE: match terrain_pyramid::TILE_QUADS and TILE_BORDER
+const float TILE_QUADS = 64.0f;
+const float TILE_BORDER = 1.0f;
+
+// xy - patch origin in height map texels, z - distance between patch vertices in texels, w - slot of the tile * MAX_LOD_COUNT + LOD level
+layout(std430, binding = 0) readonly buffer Patches {
+    vec4 patches[];
+};
+
+uniform mat4 u_model, u_view, u_projection;
+
+uniform sampler2DArray u_tiles;
+uniform vec2 u_terrain_size;
+uniform vec2 u_height_range;
+
+uniform vec3 u_camera_localspace;
+uniform vec2 u_morph_ranges[MAX_LOD_COUNT];
+
+float sample_height(vec4 patch_data, vec2 position) {
+    const float spacing = patch_data.z;
+    const float tile_span = TILE_QUADS * spacing;
+    const vec2 tile_origin = floor(patch_data.xy / tile_span) * tile_span;
+
+    const vec2 sample_coord = (position - tile_origin) / spacing + TILE_BORDER;
+    const float layer = floor(patch_data.w / MAX_LOD_COUNT);
+    const float height = texture(u_tiles, vec3((sample_coord + 0.5f) / textureSize(u_tiles, 0).xy, layer)).r;
+
+    return mix(u_height_range.x, u_height_range.y, height);
+}
+
+vec2 get_patch_position(vec4 patch_data, vec2 grid) {
+    return min(patch_data.xy + grid * patch_data.z, u_terrain_size - 1.0f);
+}
+
+void main() {
+    const vec4 patch_data = patches[gl_InstanceID];
+
+    // NOTE: morphs exactly as terrain_streamed.vert does, otherwise the terrain would shadow itself where the two surfaces differ
+    vec2 grid = vec2(gl_VertexID % (PATCH_SIZE + 1), gl_VertexID / (PATCH_SIZE + 1));
+    vec2 position = get_patch_position(patch_data, grid);
+
+    const float distance_to_camera = distance(u_camera_localspace, vec3(position.x, sample_height(patch_data, position), position.y));
+    const vec2 morph_range = u_morph_ranges[uint(patch_data.w) % MAX_LOD_COUNT];
+    const float morph = clamp((distance_to_camera - morph_range.x) / max(morph_range.y - morph_range.x, 1e-4f), 0.0f, 1.0f);
+
+    grid -= fract(grid * 0.5f) * 2.0f * morph;
+    position = get_patch_position(patch_data, grid);
+
+    gl_Position = u_projection * u_view * u_model * vec4(position.x, sample_height(patch_data, position), position.y, 1.0f);
+}
@@ -1,11 +1,18 @@
 #version 460 core
 
-layout(location = 0) in vec3 a_position;
-layout(location = 1) in vec3 a_normal;
-layout(location = 2) in vec2 a_texcoord;
+// NOTE: matches terrain::PATCH_SIZE
+const int PATCH_SIZE = 32;
+
+// xy - patch origin in height map texels, z - distance between patch vertices in texels, w - LOD level
+layout(std430, binding = 0) readonly buffer Patches {
+    vec4 patches[];
+};
 
 uniform mat4 u_model, u_view, u_projection;
 
+uniform vec2 u_terrain_size;
+uniform float u_water_height;
+
 out VS_OUT {
     vec3 frag_pos_worldspace;
     vec4 frag_pos_clipspace;
@@ -22,14 +29,18 @@ uniform struct Fog {
 } u_fog;
 
 void main() {
-    vs_out.frag_pos_worldspace = vec3(u_model * vec4(a_position, 1.0f));
+    const vec4 patch_data = patches[gl_InstanceID];
+    const vec2 grid = vec2(gl_VertexID % (PATCH_SIZE + 1), gl_VertexID / (PATCH_SIZE + 1));
+    const vec2 position = min(patch_data.xy + grid * patch_data.z, u_terrain_size - 1.0f);
+
+    vs_out.frag_pos_worldspace = vec3(u_model * vec4(position.x, u_water_height, position.y, 1.0f));
     const vec4 frag_pos_viewspace =  u_view * vec4(vs_out.frag_pos_worldspace, 1.0f);
     vs_out.frag_pos_clipspace = u_projection * frag_pos_viewspace;
-    vs_out.texcoord = a_texcoord;
+    vs_out.texcoord = vec2(position.x, u_terrain_size.y - 1.0f - position.y) / (u_terrain_size - 1.0f);
 
     float distance = length(frag_pos_viewspace.xyz);
     vs_out.visibility = exp(-pow(distance * u_fog.density, u_fog.gradient));
     vs_out.visibility = clamp(vs_out.visibility, 0.0f, 1.0f);
 
     gl_Position = vs_out.frag_pos_clipspace;
-}
\ No newline at end of file
+}
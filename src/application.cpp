@@ -23,6 +23,10 @@
 #include "terrain.hpp"
 
 #include "particle_system.hpp"
+#include "particle_batch.hpp"
+#include "particle_budget.hpp"
+#include "particle_oit.hpp"
+#include "particle_low_res.hpp"
 
 #include "random.hpp"
 
@@ -83,6 +87,8 @@ application::application(const std::string_view &title, uint32_t width, uint32_t
     const glm::vec3 camera_position(0.0f, 0.0f, 8.0f);
     m_camera.create(camera_position, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f), 45.0f, 3.0f, 10.0f);
 
+    m_thread_pool.create(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+
     m_proj_settings.x = m_proj_settings.y = 0;
     m_proj_settings.near = 0.1f;
     m_proj_settings.far = 100.0f;
@@ -91,22 +97,24 @@ application::application(const std::string_view &title, uint32_t width, uint32_t
 }
 
 void application::run() noexcept {
-    shader particles_shader(RESOURCE_DIR "shaders/particles/particles.vert", RESOURCE_DIR "shaders/particles/particles.frag");
-
-    texture_2d fire_atlas(RESOURCE_DIR "textures/particles/fire.png", false);
-    fire_atlas.set_parameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    fire_atlas.set_parameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    fire_atlas.generate_mipmap();
-
-    texture_2d explosion_atlas(RESOURCE_DIR "textures/particles/explosion.png", false);
-    explosion_atlas.set_parameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    explosion_atlas.set_parameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    explosion_atlas.generate_mipmap();
-
-    texture_2d smoke_atlas(RESOURCE_DIR "textures/particles/smoke.png", false);
-    smoke_atlas.set_parameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    smoke_atlas.set_parameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    smoke_atlas.generate_mipmap();
+    // NOTE: weighted blended OIT doesn't need depth sorting, switch to true to compare with sorted alpha blending
+    const bool particles_oit_enabled = false;
+    // NOTE: sorted particles are drawn at 1 / (downsample * downsample) of the screen pixels, 1 draws them directly
+    const uint32_t particles_downsample = 2;
+    const bool particles_low_res_enabled = !particles_oit_enabled && particles_downsample > 1;
+
+    shader particles_shader(RESOURCE_DIR "shaders/particles/particles.vert", 
+        particles_oit_enabled ? RESOURCE_DIR "shaders/particles/particles_oit.frag" : RESOURCE_DIR "shaders/particles/particles.frag");
+
+    // NOTE: layer order matches set_texture_atlas_layer() calls below
+    texture_2d_array particle_atlases({
+        RESOURCE_DIR "textures/particles/fire.png",
+        RESOURCE_DIR "textures/particles/explosion.png",
+        RESOURCE_DIR "textures/particles/smoke.png"
+    }, false);
+    particle_atlases.set_parameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    particle_atlases.set_parameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    particle_atlases.generate_mipmap();
 
 
     particle_props fire_particle_props;
@@ -126,14 +134,83 @@ void application::run() noexcept {
     smoke_particle_props.position = glm::vec3(1.0f, 0.0f, 0.0f);
 
 
-    particle_system fire_system(10000);
+    // NOTE: switch to particle_system::backend::GPU to compare with compute shader simulation
+    const particle_system::backend particles_backend = particle_system::backend::CPU;
+
+    particle_system fire_system(10000, particles_backend);
     fire_system.set_texture_atlas_dimension(8, 8);
+    fire_system.set_texture_atlas_layer(0);
 
-    particle_system explosion_system(10000);
+    particle_system explosion_system(10000, particles_backend);
     explosion_system.set_texture_atlas_dimension(6, 8);
+    explosion_system.set_texture_atlas_layer(1);
 
-    particle_system smoke_system(10000);
+    particle_system smoke_system(10000, particles_backend);
     smoke_system.set_texture_atlas_dimension(8, 8);
+    smoke_system.set_texture_atlas_layer(2);
+
+    // NOTE: fire is swirled around its vertical axis by a procedural field, smoke is stirred by turbulence
+    const vector_field fire_swirl(glm::uvec3(16), glm::vec3(-2.0f, -1.0f, -1.0f), glm::vec3(0.0f, 3.0f, 1.0f), [](const glm::vec3& position) {
+        const glm::vec3 to_axis = glm::vec3(-1.0f, position.y, 0.0f) - position;
+        return glm::vec3(-to_axis.z, 0.5f, to_axis.x) + to_axis;
+    });
+    fire_system.set_vector_field(&fire_swirl, 0.5f);
+
+    const curl_noise smoke_turbulence(1.5f, 2);
+    smoke_system.set_curl_noise(&smoke_turbulence, 0.8f);
+
+    particle_interaction smoke_interaction;
+    smoke_interaction.radius = 0.15f;
+    smoke_interaction.separation = 0.5f;
+    smoke_interaction.pressure = 0.05f;
+    smoke_interaction.rest_density = 4.0f;
+    smoke_interaction.cohesion = 0.1f;
+    smoke_system.set_particle_interaction(smoke_interaction);
+
+    particle_system* particle_systems[] = { &fire_system, &explosion_system, &smoke_system };
+    for (particle_system* system : particle_systems) {
+        system->set_thread_pool(&m_thread_pool);
+        system->set_distance_lod(15.0f, 0.25f);
+        // NOTE: simulated at 30 Hz, drawn positions are interpolated at any frame rate
+        system->set_fixed_timestep(1.0f / 30.0f);
+    }
+
+    // NOTE: GPU backend systems keep their particles on GPU, so they are drawn one by one
+    particle_batch particles_batch;
+    if (particles_backend == particle_system::backend::CPU) {
+        particles_batch.create(std::size(particle_systems) * 10000);
+        particles_batch.set_texture_atlas(&particle_atlases);
+        particles_batch.set_thread_pool(&m_thread_pool);
+
+        for (particle_system* system : particle_systems) {
+            particles_batch.add(*system);
+        }
+    }
+
+    // NOTE: fire is kept whole, smoke is thinned first when all three systems don't fit
+    particle_budget particles_budget;
+    if (particles_backend == particle_system::backend::CPU) {
+        particles_budget.create(20000, 16000 * sizeof(particle_instance));
+        particles_budget.add(fire_system, 2);
+        particles_budget.add(explosion_system, 1);
+        particles_budget.add(smoke_system, 0);
+    }
+
+    particle_oit particles_oit;
+    if (particles_oit_enabled) {
+        particles_oit.create(m_proj_settings.width, m_proj_settings.height);
+
+        particles_batch.set_depth_sorting(false);
+        for (particle_system* system : particle_systems) {
+            system->set_depth_sorting(false);
+        }
+    }
+
+    particle_low_res particles_low_res;
+    if (particles_low_res_enabled) {
+        particles_low_res.create(m_proj_settings.width, m_proj_settings.height, particles_downsample);
+        particles_low_res.set_depth_range(m_proj_settings.near, m_proj_settings.far);
+    }
 
     m_renderer.enable(GL_BLEND);
     m_renderer.blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -142,7 +219,12 @@ void application::run() noexcept {
 
     ImGuiIO& io = ImGui::GetIO();
 
-    int32_t emited_count = 10;
+    // NOTE: particles per second, the same amount as 10 particles per frame at 60 FPS
+    const float emission_rate = 600.0f;
+
+    particle_emitter fire_emitter(fire_particle_props, emission_rate);
+    particle_emitter explosion_emitter(explosion_particle_props, emission_rate);
+    particle_emitter smoke_emitter(smoke_particle_props, emission_rate);
 
     while (!glfwWindowShouldClose(m_window) && glfwGetKey(m_window, GLFW_KEY_ESCAPE) != GLFW_PRESS) {
         glfwPollEvents();
@@ -175,32 +257,63 @@ void application::run() noexcept {
 
         m_renderer.clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         
-        for (size_t i = 0; i < emited_count; ++i) {
-            fire_system.emit(fire_particle_props);
-        }
+        particles_budget.update(m_camera);
 
-        for (size_t i = 0; i < emited_count; ++i) {
-            explosion_system.emit(explosion_particle_props);
-        }
+        fire_emitter.update(io.DeltaTime, fire_system);
+        explosion_emitter.update(io.DeltaTime, explosion_system);
+        smoke_emitter.update(io.DeltaTime, smoke_system);
 
-        for (size_t i = 0; i < emited_count; ++i) {
-            smoke_system.emit(smoke_particle_props);
-        }
+        const glm::mat4 view = m_camera.get_view();
+        const glm::mat4 proj_view = m_proj_settings.projection_mat * view;
+        const frustum view_frustum(proj_view);
 
-        fire_system.update(io.DeltaTime, m_camera);
-        explosion_system.update(io.DeltaTime, m_camera);
-        smoke_system.update(io.DeltaTime, m_camera);
+        m_thread_pool.parallel_for(std::size(particle_systems), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                particle_systems[i]->simulate(io.DeltaTime, m_camera, &view_frustum);
+            }
+        });
+        
+        particles_batch.sort(m_camera, &view_frustum);
+        particles_batch.upload();
 
-        particles_shader.uniform("u_proj_view", m_proj_settings.projection_mat * m_camera.get_view());
+        for (particle_system* system : particle_systems) {
+            system->upload();
+        }
 
-        particles_shader.uniform("u_atlas", fire_atlas, 0);
-        m_renderer.render(GL_TRIANGLES, particles_shader, fire_system);
+        particles_shader.uniform("u_proj_view", proj_view);
+        particles_shader.uniform("u_camera_position", m_camera.position);
+        particles_shader.uniform("u_camera_forward", m_camera.get_forward());
+        particles_shader.uniform("u_camera_right", glm::vec3(view[0][0], view[1][0], view[2][0]));
+        particles_shader.uniform("u_camera_up", glm::vec3(view[0][1], view[1][1], view[2][1]));
+
+        if (particles_oit_enabled) {
+            particles_oit.resize(m_proj_settings.width, m_proj_settings.height);
+            particles_oit.begin_accumulation();
+        } else if (particles_low_res_enabled) {
+            particles_low_res.resize(m_proj_settings.width, m_proj_settings.height);
+            particles_low_res.begin(m_renderer);
+        }
 
-        particles_shader.uniform("u_atlas", explosion_atlas, 0);
-        m_renderer.render(GL_TRIANGLES, particles_shader, explosion_system);
+        if (particles_backend == particle_system::backend::CPU) {
+            m_renderer.render(GL_TRIANGLES, particles_shader, particles_batch);
+        } else {
+            particles_shader.uniform("u_atlas", particle_atlases, 0);
+            for (uint32_t layer = 0; layer < particle_atlases.get_layer_count(); ++layer) {
+                particles_shader.uniform("u_layer_uv_scales[" + std::to_string(layer) + "]", particle_atlases.get_layer_uv_scale(layer));
+            }
 
-        particles_shader.uniform("u_atlas", smoke_atlas, 0);
-        m_renderer.render(GL_TRIANGLES, particles_shader, smoke_system);
+            for (const particle_system* system : particle_systems) {
+                m_renderer.render(GL_TRIANGLES, particles_shader, *system);
+            }
+        }
+
+        if (particles_oit_enabled) {
+            particles_oit.end_accumulation();
+            particles_oit.composite(m_renderer);
+        } else if (particles_low_res_enabled) {
+            particles_low_res.end(m_renderer);
+            particles_low_res.composite(m_renderer);
+        }
 
         glfwSwapBuffers(m_window);
     }
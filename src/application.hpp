@@ -4,6 +4,7 @@
 
 #include "camera.hpp"
 #include "renderer.hpp"
+#include "thread_pool.hpp"
 
 #include <string>
 #include <memory>
@@ -52,6 +53,8 @@ private:
     camera m_camera;
     renderer m_renderer;
 
+    thread_pool m_thread_pool;
+
     glm::vec4 m_clear_color = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
 
     bool m_wireframed = false;
@@ -27,7 +27,28 @@ void buffer::create(int32_t target, size_t size, size_t element_size, int32_t us
     OGL_CALL(glBufferData(target, size, data, usage));
 }
 
+void buffer::create_storage(int32_t target, size_t size, size_t element_size, uint32_t flags, const void* data) noexcept {
+    if (id != 0) {
+        LOG_WARN(_target_to_string(target) + " buffer", _target_to_string(target) + "buffer recreation (prev id = " + std::to_string(id) + ")");
+        destroy();
+    }
+
+    this->size = size;
+    this->element_size = element_size;
+    this->target = target;
+    this->usage = flags;
+
+    OGL_CALL(glGenBuffers(1, &id));
+    bind();
+    OGL_CALL(glBufferStorage(target, size, data, flags));
+}
+
 void buffer::destroy() noexcept {
+    // NOTE: never created buffers are skipped, so objects without OpenGL context can be destroyed
+    if (id == 0) {
+        return;
+    }
+
     OGL_CALL(glDeleteBuffers(1, &id));
     id = 0;
 }
@@ -46,6 +67,15 @@ void *buffer::map(uint32_t access) const noexcept {
     return buffer;
 }
 
+void *buffer::map_range(size_t offset, size_t length, uint32_t access) const noexcept {
+    bind();
+
+    void* buffer = nullptr;
+    OGL_CALL(buffer = glMapBufferRange(target, offset, length, access));
+
+    return buffer;
+}
+
 bool buffer::unmap() const noexcept {
     bind();
 
@@ -60,6 +90,14 @@ void buffer::bind_base(size_t index) const noexcept {
     OGL_CALL(glBindBufferBase(target, index, id));
 }
 
+void buffer::bind_base(int32_t target, size_t index) const noexcept {
+    OGL_CALL(glBindBufferBase(target, index, id));
+}
+
+void buffer::bind_range(size_t index, size_t offset, size_t size) const noexcept {
+    OGL_CALL(glBindBufferRange(target, index, id, offset, size));
+}
+
 void buffer::bind() const noexcept {
     OGL_CALL(glBindBuffer(target, id));
 }
@@ -11,12 +11,17 @@ struct buffer : public nocopyable {
     ~buffer();
 
     void create(int32_t target, size_t size, size_t element_size, int32_t usage, const void* data) noexcept;
+    // Immutable storage (glBufferStorage), flags are stored in usage
+    void create_storage(int32_t target, size_t size, size_t element_size, uint32_t flags, const void* data) noexcept;
     void destroy() noexcept;
 
     void subdata(uint32_t offset, size_t size, const void* data) const noexcept;
     void* map(uint32_t access) const noexcept;
+    void* map_range(size_t offset, size_t length, uint32_t access) const noexcept;
     bool unmap() const noexcept;
     void bind_base(size_t index) const noexcept;
+    void bind_base(int32_t target, size_t index) const noexcept;
+    void bind_range(size_t index, size_t offset, size_t size) const noexcept;
 
     void bind() const noexcept;
     void unbind() const noexcept;
@@ -0,0 +1,221 @@
+#include "curl_noise.hpp"
+
+#include "simd.hpp"
+
+#include <cmath>
+
+namespace {
+    constexpr uint32_t HASH_X = 0x8DA6B343u;
+    constexpr uint32_t HASH_Y = 0xD8163841u;
+    constexpr uint32_t HASH_Z = 0xCB1AB31Fu;
+    constexpr uint32_t OCTAVE_SEED_STEP = 0x9E3779B9u;
+
+    inline uint32_t hash(uint32_t x, uint32_t y, uint32_t z, uint32_t seed) noexcept {
+        uint32_t h = seed ^ (x * HASH_X) ^ (y * HASH_Y) ^ (z * HASH_Z);
+        h ^= h >> 16;
+        h *= 0x7FEB352Du;
+        h ^= h >> 15;
+        h *= 0x846CA68Bu;
+        h ^= h >> 16;
+        return h;
+    }
+
+    // Lattice value in [-1, 1]
+    inline float lattice(int32_t x, int32_t y, int32_t z, uint32_t seed) noexcept {
+        return static_cast<float>(hash(uint32_t(x), uint32_t(y), uint32_t(z), seed) >> 8) * (2.0f / 16777216.0f) - 1.0f;
+    }
+
+    // Value noise with quintic interpolation, returns derivatives only (see "Value Noise Derivatives", Quilez)
+    inline glm::vec3 noise_derivatives(float px, float py, float pz, uint32_t seed) noexcept {
+        const float fx = std::floor(px), fy = std::floor(py), fz = std::floor(pz);
+        const int32_t ix = int32_t(fx), iy = int32_t(fy), iz = int32_t(fz);
+        const glm::vec3 w(px - fx, py - fy, pz - fz);
+
+        const glm::vec3 u = w * w * w * (w * (w * 6.0f - 15.0f) + 10.0f);
+        const glm::vec3 du = 30.0f * w * w * (w * (w - 2.0f) + 1.0f);
+
+        const float a = lattice(ix,     iy,     iz,     seed);
+        const float b = lattice(ix + 1, iy,     iz,     seed);
+        const float c = lattice(ix,     iy + 1, iz,     seed);
+        const float d = lattice(ix + 1, iy + 1, iz,     seed);
+        const float e = lattice(ix,     iy,     iz + 1, seed);
+        const float f = lattice(ix + 1, iy,     iz + 1, seed);
+        const float g = lattice(ix,     iy + 1, iz + 1, seed);
+        const float h = lattice(ix + 1, iy + 1, iz + 1, seed);
+
+        const float k1 = b - a;
+        const float k2 = c - a;
+        const float k3 = e - a;
+        const float k4 = a - b - c + d;
+        const float k5 = a - c - e + g;
+        const float k6 = a - b - e + f;
+        const float k7 = -a + b + c - d + e - f - g + h;
+
+        return du * glm::vec3(
+            k1 + k4 * u.y + k6 * u.z + k7 * u.y * u.z,
+            k2 + k5 * u.z + k4 * u.x + k7 * u.z * u.x,
+            k3 + k6 * u.x + k5 * u.y + k7 * u.x * u.y
+        );
+    }
+    // WIDTH points of noise space evaluated at once, see noise_derivatives()
+    struct simd_vec3 {
+        simd::type x, y, z;
+    };
+
+    // Cell of the lattice containing the points with their interpolation weights. Hashed coordinates of the cell corners are
+    // premultiplied, so that lattice values of the 8 corners differ by the seed only and multiplication wraps the same way hash() does
+    struct simd_cell {
+        simd::itype hx[2], hy[2], hz[2];
+        simd_vec3 u, du;
+    };
+
+    inline simd::type simd_fade(simd::type w) noexcept {
+        // w * w * w * (w * (w * 6 - 15) + 10)
+        const simd::type inner = simd::add(simd::mul(w, simd::sub(simd::mul(w, simd::set(6.0f)), simd::set(15.0f))), simd::set(10.0f));
+        return simd::mul(simd::mul(simd::mul(w, w), w), inner);
+    }
+
+    inline simd::type simd_fade_derivative(simd::type w) noexcept {
+        // 30 * w * w * (w * (w - 2) + 1)
+        const simd::type inner = simd::add(simd::mul(w, simd::sub(w, simd::set(2.0f))), simd::set(1.0f));
+        return simd::mul(simd::mul(simd::mul(simd::set(30.0f), w), w), inner);
+    }
+
+    inline simd_cell simd_locate(simd::type px, simd::type py, simd::type pz) noexcept {
+        const simd::type fx = simd::floor(px), fy = simd::floor(py), fz = simd::floor(pz);
+        const simd_vec3 w = { simd::sub(px, fx), simd::sub(py, fy), simd::sub(pz, fz) };
+
+        simd_cell cell;
+        cell.hx[0] = simd::imul(simd::to_int(fx), simd::iset(HASH_X));
+        cell.hy[0] = simd::imul(simd::to_int(fy), simd::iset(HASH_Y));
+        cell.hz[0] = simd::imul(simd::to_int(fz), simd::iset(HASH_Z));
+        cell.hx[1] = simd::iadd(cell.hx[0], simd::iset(HASH_X));
+        cell.hy[1] = simd::iadd(cell.hy[0], simd::iset(HASH_Y));
+        cell.hz[1] = simd::iadd(cell.hz[0], simd::iset(HASH_Z));
+        cell.u = { simd_fade(w.x), simd_fade(w.y), simd_fade(w.z) };
+        cell.du = { simd_fade_derivative(w.x), simd_fade_derivative(w.y), simd_fade_derivative(w.z) };
+        return cell;
+    }
+
+    inline simd::type simd_lattice(const simd_cell& cell, int32_t x, int32_t y, int32_t z, simd::itype seed) noexcept {
+        simd::itype h = simd::ixor(simd::ixor(seed, cell.hx[x]), simd::ixor(cell.hy[y], cell.hz[z]));
+        h = simd::ixor(h, simd::shift_right<16>(h));
+        h = simd::imul(h, simd::iset(0x7FEB352Du));
+        h = simd::ixor(h, simd::shift_right<15>(h));
+        h = simd::imul(h, simd::iset(0x846CA68Bu));
+        h = simd::ixor(h, simd::shift_right<16>(h));
+
+        // NOTE: 24-bit values convert exactly through the signed conversion
+        return simd::sub(simd::mul(simd::to_float(simd::shift_right<8>(h)), simd::set(2.0f / 16777216.0f)), simd::set(1.0f));
+    }
+
+    // noise_derivatives() of WIDTH points, lanes follow the scalar version operation by operation
+    inline simd_vec3 simd_noise_derivatives(const simd_cell& cell, uint32_t seed) noexcept {
+        const simd::itype seed_v = simd::iset(seed);
+
+        const simd::type a = simd_lattice(cell, 0, 0, 0, seed_v);
+        const simd::type b = simd_lattice(cell, 1, 0, 0, seed_v);
+        const simd::type c = simd_lattice(cell, 0, 1, 0, seed_v);
+        const simd::type d = simd_lattice(cell, 1, 1, 0, seed_v);
+        const simd::type e = simd_lattice(cell, 0, 0, 1, seed_v);
+        const simd::type f = simd_lattice(cell, 1, 0, 1, seed_v);
+        const simd::type g = simd_lattice(cell, 0, 1, 1, seed_v);
+        const simd::type h = simd_lattice(cell, 1, 1, 1, seed_v);
+
+        const simd::type k1 = simd::sub(b, a);
+        const simd::type k2 = simd::sub(c, a);
+        const simd::type k3 = simd::sub(e, a);
+        const simd::type k4 = simd::add(simd::sub(simd::sub(a, b), c), d);
+        const simd::type k5 = simd::add(simd::sub(simd::sub(a, c), e), g);
+        const simd::type k6 = simd::add(simd::sub(simd::sub(a, b), e), f);
+        const simd::type k7 = simd::add(simd::sub(simd::sub(simd::add(simd::sub(simd::add(simd::sub(b, a), c), d), e), f), g), h);
+
+        const simd_vec3& u = cell.u;
+        const simd::type dx = simd::add(simd::add(simd::add(k1, simd::mul(k4, u.y)), simd::mul(k6, u.z)), simd::mul(simd::mul(k7, u.y), u.z));
+        const simd::type dy = simd::add(simd::add(simd::add(k2, simd::mul(k5, u.z)), simd::mul(k4, u.x)), simd::mul(simd::mul(k7, u.z), u.x));
+        const simd::type dz = simd::add(simd::add(simd::add(k3, simd::mul(k6, u.x)), simd::mul(k5, u.y)), simd::mul(simd::mul(k7, u.x), u.y));
+
+        return { simd::mul(cell.du.x, dx), simd::mul(cell.du.y, dy), simd::mul(cell.du.z, dz) };
+    }
+}
+
+curl_noise::curl_noise(float frequency, uint32_t octave_count, uint32_t seed) {
+    create(frequency, octave_count, seed);
+}
+
+void curl_noise::create(float frequency, uint32_t octave_count, uint32_t seed) noexcept {
+    m_frequency = frequency;
+    m_octave_count = octave_count > 0 ? octave_count : 1;
+    m_seed = seed;
+}
+
+glm::vec3 curl_noise::sample(const glm::vec3& position) const noexcept {
+    glm::vec3 result(0.0f);
+    accumulate(&position.x, &position.y, &position.z, 1, 1.0f, &result.x, &result.y, &result.z);
+    return result;
+}
+
+void curl_noise::accumulate(const float* x, const float* y, const float* z, size_t count, float scale, float* out_x, float* out_y, float* out_z) const noexcept {
+    // NOTE: potential components use different seeds, so they are uncorrelated
+    const uint32_t seed0 = m_seed * 3u;
+    const uint32_t seed1 = m_seed * 3u + 1u;
+    const uint32_t seed2 = m_seed * 3u + 2u;
+
+    // NOTE: WIDTH particles per iteration, the rest by the scalar version
+    size_t i = 0;
+    for (; i + simd::WIDTH <= count; i += simd::WIDTH) {
+        const simd::type x_v = simd::load(x + i);
+        const simd::type y_v = simd::load(y + i);
+        const simd::type z_v = simd::load(z + i);
+
+        simd_vec3 curl = { simd::set(0.0f), simd::set(0.0f), simd::set(0.0f) };
+
+        float frequency = m_frequency;
+        float amplitude = 1.0f;
+        for (uint32_t octave = 0; octave < m_octave_count; ++octave) {
+            const simd::type frequency_v = simd::set(frequency);
+            const simd_cell cell = simd_locate(simd::mul(x_v, frequency_v), simd::mul(y_v, frequency_v), simd::mul(z_v, frequency_v));
+
+            const simd_vec3 d0 = simd_noise_derivatives(cell, seed0 + octave * OCTAVE_SEED_STEP);
+            const simd_vec3 d1 = simd_noise_derivatives(cell, seed1 + octave * OCTAVE_SEED_STEP);
+            const simd_vec3 d2 = simd_noise_derivatives(cell, seed2 + octave * OCTAVE_SEED_STEP);
+
+            const simd::type amplitude_v = simd::set(amplitude);
+            curl.x = simd::add(curl.x, simd::mul(simd::sub(d2.y, d1.z), amplitude_v));
+            curl.y = simd::add(curl.y, simd::mul(simd::sub(d0.z, d2.x), amplitude_v));
+            curl.z = simd::add(curl.z, simd::mul(simd::sub(d1.x, d0.y), amplitude_v));
+
+            frequency *= 2.0f;
+            amplitude *= 0.5f;
+        }
+
+        const simd::type scale_v = simd::set(scale);
+        simd::store(out_x + i, simd::add(simd::load(out_x + i), simd::mul(curl.x, scale_v)));
+        simd::store(out_y + i, simd::add(simd::load(out_y + i), simd::mul(curl.y, scale_v)));
+        simd::store(out_z + i, simd::add(simd::load(out_z + i), simd::mul(curl.z, scale_v)));
+    }
+
+    for (; i < count; ++i) {
+        glm::vec3 curl(0.0f);
+
+        float frequency = m_frequency;
+        float amplitude = 1.0f;
+        for (uint32_t octave = 0; octave < m_octave_count; ++octave) {
+            const float px = x[i] * frequency, py = y[i] * frequency, pz = z[i] * frequency;
+
+            const glm::vec3 d0 = noise_derivatives(px, py, pz, seed0 + octave * OCTAVE_SEED_STEP);
+            const glm::vec3 d1 = noise_derivatives(px, py, pz, seed1 + octave * OCTAVE_SEED_STEP);
+            const glm::vec3 d2 = noise_derivatives(px, py, pz, seed2 + octave * OCTAVE_SEED_STEP);
+
+            // NOTE: derivatives are taken in noise space, so the magnitude doesn't depend on frequency
+            curl += glm::vec3(d2.y - d1.z, d0.z - d2.x, d1.x - d0.y) * amplitude;
+
+            frequency *= 2.0f;
+            amplitude *= 0.5f;
+        }
+
+        out_x[i] += curl.x * scale;
+        out_y[i] += curl.y * scale;
+        out_z[i] += curl.z * scale;
+    }
+}
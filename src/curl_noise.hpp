@@ -0,0 +1,25 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+// Divergence-free turbulence (Bridson et al. 2007). The field is the curl of a vector potential made of three value noises, 
+// their derivatives are evaluated analytically, so one sample costs three noise lookups instead of finite differences
+class curl_noise {
+public:
+    curl_noise() = default;
+    curl_noise(float frequency, uint32_t octave_count = 1, uint32_t seed = 0);
+
+    void create(float frequency, uint32_t octave_count = 1, uint32_t seed = 0) noexcept;
+
+    glm::vec3 sample(const glm::vec3& position) const noexcept;
+
+    // Batch version of sample() over SoA streams: out += sample(position) * scale for count positions
+    void accumulate(const float* x, const float* y, const float* z, size_t count, float scale, float* out_x, float* out_y, float* out_z) const noexcept;
+
+private:
+    float m_frequency = 1.0f;
+    uint32_t m_octave_count = 1;
+    uint32_t m_seed = 0;
+};
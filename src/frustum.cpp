@@ -0,0 +1,50 @@
+#include "frustum.hpp"
+
+frustum::frustum(const glm::mat4& proj_view) {
+    create(proj_view);
+}
+
+void frustum::create(const glm::mat4& proj_view) noexcept {
+    const glm::vec4 row0(proj_view[0][0], proj_view[1][0], proj_view[2][0], proj_view[3][0]);
+    const glm::vec4 row1(proj_view[0][1], proj_view[1][1], proj_view[2][1], proj_view[3][1]);
+    const glm::vec4 row2(proj_view[0][2], proj_view[1][2], proj_view[2][2], proj_view[3][2]);
+    const glm::vec4 row3(proj_view[0][3], proj_view[1][3], proj_view[2][3], proj_view[3][3]);
+
+    m_planes[LEFT_PLANE] = row3 + row0;
+    m_planes[RIGHT_PLANE] = row3 - row0;
+    m_planes[BOTTOM_PLANE] = row3 + row1;
+    m_planes[TOP_PLANE] = row3 - row1;
+    m_planes[NEAR_PLANE] = row3 + row2;
+    m_planes[FAR_PLANE] = row3 - row2;
+
+    for (glm::vec4& plane : m_planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+}
+
+bool frustum::is_sphere_visible(const glm::vec3& center, float radius) const noexcept {
+    for (const glm::vec4& plane : m_planes) {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool frustum::is_aabb_visible(const glm::vec3& min, const glm::vec3& max) const noexcept {
+    for (const glm::vec4& plane : m_planes) {
+        // NOTE: the corner which is the farthest along the plane normal
+        const glm::vec3 positive(plane.x >= 0.0f ? max.x : min.x, plane.y >= 0.0f ? max.y : min.y, plane.z >= 0.0f ? max.z : min.z);
+        
+        if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+const glm::vec4& frustum::get_plane(plane plane) const noexcept {
+    return m_planes[plane];
+}
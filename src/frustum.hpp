@@ -0,0 +1,25 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <array>
+
+// View frustum planes extracted from a projection-view matrix (Gribb, Hartmann). 
+// Planes point inside, xyz - normalized normal, w - distance
+class frustum {
+public:
+    enum plane { LEFT_PLANE, RIGHT_PLANE, BOTTOM_PLANE, TOP_PLANE, NEAR_PLANE, FAR_PLANE, PLANE_COUNT };
+
+public:
+    frustum() = default;
+    frustum(const glm::mat4& proj_view);
+
+    void create(const glm::mat4& proj_view) noexcept;
+
+    bool is_sphere_visible(const glm::vec3& center, float radius) const noexcept;
+    bool is_aabb_visible(const glm::vec3& min, const glm::vec3& max) const noexcept;
+
+    const glm::vec4& get_plane(plane plane) const noexcept;
+
+private:
+    std::array<glm::vec4, PLANE_COUNT> m_planes;
+};
@@ -0,0 +1,111 @@
+#include "mapped_file.hpp"
+
+#include "assert.hpp"
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+mapped_file::mapped_file(const std::string& filepath) {
+    create(filepath);
+}
+
+mapped_file::~mapped_file() {
+    destroy();
+}
+
+void mapped_file::create(const std::string& filepath) noexcept {
+    destroy();
+
+#if defined(_WIN32)
+    m_file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE) {
+        m_file = nullptr;
+        ASSERT(false, "mapped_file", "couldn't open file \"" + filepath + "\"");
+        return;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0) {
+        ASSERT(false, "mapped_file", "couldn't get size of \"" + filepath + "\" or it is empty");
+        destroy();
+        return;
+    }
+
+    m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping == nullptr) {
+        ASSERT(false, "mapped_file", "couldn't map file \"" + filepath + "\"");
+        destroy();
+        return;
+    }
+
+    m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    m_size = m_data != nullptr ? static_cast<size_t>(size.QuadPart) : 0;
+#else
+    const int file = open(filepath.c_str(), O_RDONLY);
+    if (file < 0) {
+        ASSERT(false, "mapped_file", "couldn't open file \"" + filepath + "\"");
+        return;
+    }
+
+    struct stat info;
+    if (fstat(file, &info) != 0 || info.st_size == 0) {
+        ASSERT(false, "mapped_file", "couldn't get size of \"" + filepath + "\" or it is empty");
+        close(file);
+        return;
+    }
+
+    // NOTE: the mapping keeps the file referenced, so the descriptor isn't needed anymore
+    void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+
+    if (data != MAP_FAILED) {
+        m_data = static_cast<const uint8_t*>(data);
+        m_size = static_cast<size_t>(info.st_size);
+    }
+#endif
+
+    ASSERT(m_data != nullptr, "mapped_file", "couldn't map file \"" + filepath + "\"");
+}
+
+void mapped_file::destroy() noexcept {
+#if defined(_WIN32)
+    if (m_data != nullptr) {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping != nullptr) {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+    }
+    if (m_file != nullptr) {
+        CloseHandle(m_file);
+        m_file = nullptr;
+    }
+#else
+    if (m_data != nullptr) {
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+#endif
+
+    m_data = nullptr;
+    m_size = 0;
+}
+
+const uint8_t* mapped_file::get_data() const noexcept {
+    return m_data;
+}
+
+size_t mapped_file::get_size() const noexcept {
+    return m_size;
+}
+
+bool mapped_file::is_valid() const noexcept {
+    return m_data != nullptr;
+}
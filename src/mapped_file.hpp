@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "nocopyable.hpp"
+
+// Read-only memory mapping of a whole file. Nothing is read on create(), pages are loaded by the OS on the first access
+class mapped_file : public nocopyable {
+public:
+    mapped_file() = default;
+    mapped_file(const std::string& filepath);
+    ~mapped_file();
+
+    void create(const std::string& filepath) noexcept;
+    void destroy() noexcept;
+
+    const uint8_t* get_data() const noexcept;
+    size_t get_size() const noexcept;
+
+    bool is_valid() const noexcept;
+
+private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+
+#if defined(_WIN32)
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#endif
+};
@@ -0,0 +1,148 @@
+#include "particle_batch.hpp"
+
+#include <algorithm>
+
+particle_batch::particle_batch(size_t max_particle_count) {
+    create(max_particle_count);
+}
+
+particle_batch::~particle_batch() {
+    destroy();
+}
+
+void particle_batch::create(size_t max_particle_count) noexcept {
+    ASSERT(max_particle_count > 0, "particle_batch", "max_particle_count is equal 0");
+
+    m_sort_entries.reserve(max_particle_count);
+    m_sort_temp.reserve(max_particle_count);
+
+    m_instances_ring.create(GL_SHADER_STORAGE_BUFFER, max_particle_count * sizeof(particle_instance), sizeof(particle_instance));
+}
+
+void particle_batch::destroy() noexcept {
+    for (particle_system* system : m_systems) {
+        system->m_is_batched = false;
+    }
+    m_systems.clear();
+
+    m_instances_ring.destroy();
+    m_instance_count = 0;
+}
+
+void particle_batch::add(particle_system& system) noexcept {
+    ASSERT(system.get_backend() == particle_system::backend::CPU, "particle_batch", "only CPU backend particle systems can be batched");
+    ASSERT(!system.m_is_batched, "particle_batch", "particle system is already batched");
+    ASSERT(system.m_pool.capacity() <= PARTICLE_INDEX_MASK + 1, "particle_batch", "particle system is too big to be batched");
+    ASSERT(m_systems.size() < (1u << (32 - SYSTEM_INDEX_SHIFT)), "particle_batch", "too many particle systems");
+    ASSERT(system.m_atlas_layer < MAX_ATLAS_LAYERS, "particle_batch", "atlas layer is out of range");
+
+    system.m_is_batched = true;
+    m_systems.emplace_back(&system);
+}
+
+void particle_batch::remove(particle_system& system) noexcept {
+    const auto it = std::find(m_systems.begin(), m_systems.end(), &system);
+    if (it == m_systems.end()) {
+        LOG_WARN("particle_batch", "removing of not batched particle system");
+        return;
+    }
+
+    system.m_is_batched = false;
+    m_systems.erase(it);
+}
+
+void particle_batch::sort(const camera& camera, const frustum* frustum) noexcept {
+    size_t live_count = 0;
+    bool lod_enabled = false;
+    for (const particle_system* system : m_systems) {
+        live_count += system->m_pool.live_count;
+        lod_enabled = lod_enabled || system->_is_thinning_enabled();
+    }
+
+    m_instance_count = live_count;
+    m_first_entry = 0;
+    m_use_sort_entries = m_depth_sorting || frustum != nullptr || lod_enabled;
+
+    const size_t max_instance_count = m_instances_ring.get_region_size() / sizeof(particle_instance);
+
+    if (m_use_sort_entries && live_count > 0) {
+        m_sort_entries.resize(live_count);
+
+        size_t offset = 0;
+        for (uint32_t system_index = 0; system_index < m_systems.size(); ++system_index) {
+            const uint32_t index_bits = system_index << SYSTEM_INDEX_SHIFT;
+            offset += m_systems[system_index]->_collect_visible(camera.position, frustum, index_bits, m_sort_entries.data() + offset);
+        }
+
+        m_sort_entries.resize(offset);
+        m_instance_count = offset;
+
+        if (m_depth_sorting) {
+            radix_sort(m_sort_entries, m_sort_temp);
+        }
+    }
+
+    if (m_instance_count > max_instance_count) {
+        LOG_WARN("particle_batch", "particles count exceeds batch capacity, exceeding particles are dropped");
+
+        // NOTE: sorted entries go back-to-front, so the farthest particles are skipped
+        if (m_use_sort_entries) {
+            m_first_entry = m_instance_count - max_instance_count;
+        }
+        m_instance_count = max_instance_count;
+    }
+}
+
+void particle_batch::upload() noexcept {
+    if (m_instance_count == 0) {
+        return;
+    }
+
+    particle_instance* instances = static_cast<particle_instance*>(m_instances_ring.next_region());
+
+    if (!m_use_sort_entries) {
+        size_t offset = 0;
+        for (const particle_system* system : m_systems) {
+            const size_t count = std::min(system->m_pool.live_count, m_instance_count - offset);
+
+            parallel_for(m_thread_pool, count, PARALLEL_GRAIN_SIZE, [system, instances, offset](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    system->_write_instance(i, instances[offset + i]);
+                }
+            });
+
+            offset += count;
+        }
+        return;
+    }
+
+    const sort_entry* entries = m_sort_entries.data() + m_first_entry;
+
+    parallel_for(m_thread_pool, m_instance_count, PARALLEL_GRAIN_SIZE, [this, entries, instances](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const uint32_t index = entries[i].index;
+            m_systems[index >> SYSTEM_INDEX_SHIFT]->_write_instance(index & PARTICLE_INDEX_MASK, instances[i]);
+        }
+    });
+}
+
+void particle_batch::bind_buffers() const noexcept {
+    m_instances_ring.bind_range(0);
+}
+
+void particle_batch::set_depth_sorting(bool enabled) noexcept {
+    m_depth_sorting = enabled;
+}
+
+void particle_batch::set_texture_atlas(const texture_2d_array* atlas) noexcept {
+    ASSERT(atlas == nullptr || atlas->get_layer_count() <= MAX_ATLAS_LAYERS, "particle_batch", "atlas has too many layers");
+    m_atlas = atlas;
+}
+
+void particle_batch::set_thread_pool(thread_pool* pool) noexcept {
+    m_thread_pool = pool;
+}
+
+size_t particle_batch::get_instance_count() const noexcept {
+    return m_instance_count;
+}
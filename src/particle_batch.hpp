@@ -0,0 +1,67 @@
+#pragma once
+#include <vector>
+
+#include "particle_system.hpp"
+#include "texture_2d_array.hpp"
+
+#include "nocopyable.hpp"
+
+// Merges instances of several CPU backend particle systems into one buffer. Particles are sorted all together,
+// so overlapping systems blend correctly, and drawn by one instanced call. Every system picks its atlas 
+// from texture_2d_array by set_texture_atlas_layer()
+class particle_batch : public nocopyable {
+    friend class renderer;
+public:
+    static constexpr size_t MAX_ATLAS_LAYERS = 8;
+
+public:
+    particle_batch() = default;
+    particle_batch(size_t max_particle_count);
+    ~particle_batch();
+
+    void create(size_t max_particle_count) noexcept;
+    void destroy() noexcept;
+
+    // Registered system isn't sorted and uploaded by itself anymore
+    void add(particle_system& system) noexcept;
+    void remove(particle_system& system) noexcept;
+
+    // Must be called after the systems have been simulated. Culls particles outside of frustum unless it's nullptr. 
+    // Doesn't touch OpenGL
+    void sort(const camera& camera, const frustum* frustum = nullptr) noexcept;
+    // Must be called from the thread which owns the OpenGL context
+    void upload() noexcept;
+
+    void bind_buffers() const noexcept;
+
+    // Without sorting systems are written one after another, use it with particle_oit only
+    void set_depth_sorting(bool enabled) noexcept;
+    void set_texture_atlas(const texture_2d_array* atlas) noexcept;
+    void set_thread_pool(thread_pool* pool) noexcept;
+
+    size_t get_instance_count() const noexcept;
+
+private:
+    static constexpr size_t PARALLEL_GRAIN_SIZE = 2048;
+
+    // NOTE: sort entry index keeps system index in high bits and particle index in low bits
+    static constexpr uint32_t SYSTEM_INDEX_SHIFT = 24;
+    static constexpr uint32_t PARTICLE_INDEX_MASK = (1u << SYSTEM_INDEX_SHIFT) - 1;
+
+    std::vector<particle_system*> m_systems;
+
+    std::vector<sort_entry> m_sort_entries;
+    std::vector<sort_entry> m_sort_temp;
+
+    ring_buffer m_instances_ring;
+
+    const texture_2d_array* m_atlas = nullptr;
+
+    thread_pool* m_thread_pool = nullptr;
+
+    bool m_depth_sorting = true;
+    bool m_use_sort_entries = false;
+
+    size_t m_first_entry = 0;
+    size_t m_instance_count = 0;
+};
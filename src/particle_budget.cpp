@@ -0,0 +1,108 @@
+#include "particle_budget.hpp"
+
+#include <algorithm>
+
+#include <glm/gtx/norm.hpp>
+
+particle_budget::particle_budget(size_t max_particle_count, size_t max_upload_bytes) {
+    create(max_particle_count, max_upload_bytes);
+}
+
+particle_budget::~particle_budget() {
+    destroy();
+}
+
+void particle_budget::create(size_t max_particle_count, size_t max_upload_bytes) noexcept {
+    m_max_particle_count = max_particle_count;
+    m_max_upload_bytes = max_upload_bytes;
+}
+
+void particle_budget::destroy() noexcept {
+    for (entry& entry : m_entries) {
+        entry.system->_set_budget(std::numeric_limits<size_t>::max(), 1.0f);
+    }
+
+    m_entries.clear();
+    m_live_count = 0;
+    m_upload_bytes = 0;
+}
+
+void particle_budget::add(particle_system& system, uint32_t priority) noexcept {
+    ASSERT(system.get_backend() != particle_system::backend::GPU, "particle_budget", "GPU backend particle counts aren't known on CPU");
+
+    const auto it = std::find_if(m_entries.begin(), m_entries.end(), [&system](const entry& entry) { return entry.system == &system; });
+    if (it != m_entries.end()) {
+        LOG_WARN("particle_budget", "particle system is already budgeted, priority is updated");
+        it->priority = priority;
+        return;
+    }
+
+    m_entries.emplace_back(entry{ &system, priority, 0.0f });
+}
+
+void particle_budget::remove(particle_system& system) noexcept {
+    const auto it = std::find_if(m_entries.begin(), m_entries.end(), [&system](const entry& entry) { return entry.system == &system; });
+    if (it == m_entries.end()) {
+        LOG_WARN("particle_budget", "removing of not budgeted particle system");
+        return;
+    }
+
+    system._set_budget(std::numeric_limits<size_t>::max(), 1.0f);
+    m_entries.erase(it);
+}
+
+void particle_budget::update(const camera& camera) noexcept {
+    for (entry& entry : m_entries) {
+        entry.distance2 = glm::length2(camera.position - entry.system->m_last_emit_position);
+    }
+
+    std::sort(m_entries.begin(), m_entries.end(), [](const entry& a, const entry& b) {
+        return a.priority != b.priority ? a.priority > b.priority : a.distance2 < b.distance2;
+    });
+
+    size_t remaining_particles = m_max_particle_count;
+    size_t remaining_instances = m_max_upload_bytes / sizeof(particle_instance);
+
+    m_live_count = 0;
+    m_upload_bytes = 0;
+
+    for (entry& entry : m_entries) {
+        particle_system& system = *entry.system;
+
+        const size_t live_count = system.m_pool.live_count;
+        // NOTE: particles which die during the frame are counted too, so the demand is a bit overestimated
+        const size_t demand = live_count + system.m_requested_emit_count;
+        system.m_requested_emit_count = 0;
+
+        m_live_count += live_count;
+        m_upload_bytes += system.m_visible_count * sizeof(particle_instance);
+
+        const size_t particle_share = std::min(demand, remaining_particles);
+        remaining_particles -= particle_share;
+
+        // NOTE: system which fits isn't limited at all, so that emission spikes within a frame aren't cut.
+        // The overshoot is taken from the lower priority systems next frame
+        const size_t live_limit = particle_share < demand ? particle_share : std::numeric_limits<size_t>::max();
+
+        float density = live_count > particle_share ? static_cast<float>(particle_share) / static_cast<float>(live_count) : 1.0f;
+
+        // NOTE: visible count of the last frame is already thinned by the previous density
+        const float drawn_estimate = static_cast<float>(system.m_visible_count) / system.m_budget_density * density;
+        const size_t instance_share = std::min(static_cast<size_t>(drawn_estimate), remaining_instances);
+        remaining_instances -= instance_share;
+
+        if (drawn_estimate > 0.0f && static_cast<float>(instance_share) < drawn_estimate) {
+            density *= static_cast<float>(instance_share) / drawn_estimate;
+        }
+
+        system._set_budget(live_limit, density);
+    }
+}
+
+size_t particle_budget::get_live_count() const noexcept {
+    return m_live_count;
+}
+
+size_t particle_budget::get_upload_bytes() const noexcept {
+    return m_upload_bytes;
+}
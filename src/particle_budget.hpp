@@ -0,0 +1,47 @@
+#pragma once
+#include <vector>
+
+#include "particle_system.hpp"
+
+#include "nocopyable.hpp"
+
+// Shares global limits of live particles and uploaded instance bytes per frame between CPU backend particle systems.
+// Systems are served in order of priority (higher first) and distance to the camera (nearer first). 
+// The ones which don't fit get their emission throttled, particles which are already alive over the share are decimated 
+// at draw time the same way distance LOD does it
+class particle_budget : public nocopyable {
+public:
+    particle_budget() = default;
+    particle_budget(size_t max_particle_count, size_t max_upload_bytes);
+    ~particle_budget();
+
+    void create(size_t max_particle_count, size_t max_upload_bytes) noexcept;
+    void destroy() noexcept;
+
+    // Systems aren't owned. Removed system is released from the limits
+    void add(particle_system& system, uint32_t priority) noexcept;
+    void remove(particle_system& system) noexcept;
+
+    // Must be called once per frame before emission, uses counts of the previous frame.
+    // Doesn't touch OpenGL
+    void update(const camera& camera) noexcept;
+
+    size_t get_live_count() const noexcept;
+    size_t get_upload_bytes() const noexcept;
+
+private:
+    struct entry {
+        particle_system* system;
+        uint32_t priority;
+        float distance2;
+    };
+
+private:
+    std::vector<entry> m_entries;
+
+    size_t m_max_particle_count = 0;
+    size_t m_max_upload_bytes = 0;
+
+    size_t m_live_count = 0;
+    size_t m_upload_bytes = 0;
+};
@@ -0,0 +1,166 @@
+#include "particle_low_res.hpp"
+
+#include "renderer.hpp"
+
+particle_low_res::particle_low_res(uint32_t width, uint32_t height, uint32_t downsample) {
+    create(width, height, downsample);
+}
+
+void particle_low_res::create(uint32_t width, uint32_t height, uint32_t downsample) noexcept {
+    ASSERT(width > 0 && height > 0, "particle_low_res", "invalid targets size");
+    ASSERT(downsample > 0, "particle_low_res", "downsample is equal 0");
+
+    m_width = width;
+    m_height = height;
+    m_downsample = downsample;
+
+    m_scene_fbo.create();
+    m_low_res_fbo.create();
+    _create_targets();
+
+    m_depth_shader.create(RESOURCE_DIR "shaders/particles/oit_composite.vert", RESOURCE_DIR "shaders/particles/low_res_depth.frag");
+    m_upsample_shader.create(RESOURCE_DIR "shaders/particles/oit_composite.vert", RESOURCE_DIR "shaders/particles/low_res_upsample.frag");
+
+    std::vector<mesh::vertex> vertices = {
+        mesh::vertex{glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f)},
+        mesh::vertex{glm::vec3(-1.0f,  1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f)},
+        mesh::vertex{glm::vec3( 1.0f,  1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(1.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f)},
+        mesh::vertex{glm::vec3( 1.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f)},
+    };
+
+    std::vector<uint32_t> indices = {
+        0, 1, 2,
+        0, 2, 3
+    };
+
+    m_quad.create(vertices, indices);
+}
+
+void particle_low_res::destroy() noexcept {
+    m_scene_depth.destroy();
+    m_particles.destroy();
+    m_low_res_depth.destroy();
+    m_scene_fbo.destroy();
+    m_low_res_fbo.destroy();
+
+    m_width = m_height = 0;
+}
+
+void particle_low_res::resize(uint32_t width, uint32_t height) noexcept {
+    if (width == 0 || height == 0 || (width == m_width && height == m_height)) {
+        return;
+    }
+
+    m_width = width;
+    m_height = height;
+
+    _create_targets();
+}
+
+void particle_low_res::set_depth_range(float near, float far) noexcept {
+    ASSERT(near > 0.0f && far > near, "particle_low_res", "invalid depth range");
+
+    m_near = near;
+    m_far = far;
+}
+
+void particle_low_res::begin(const renderer& renderer) const noexcept {
+    OGL_CALL(glBlitNamedFramebuffer(0, m_scene_fbo.get_id(), 0, 0, m_width, m_height, 0, 0, m_width, m_height, GL_DEPTH_BUFFER_BIT, GL_NEAREST));
+
+    m_low_res_fbo.bind();
+    renderer.viewport(0, 0, get_width(), get_height());
+
+    // NOTE: depth is written by the fullscreen pass, every low resolution texel takes the farthest depth of its block
+    OGL_CALL(glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE));
+    OGL_CALL(glDepthMask(GL_TRUE));
+    renderer.enable(GL_DEPTH_TEST);
+    renderer.disable(GL_BLEND);
+    renderer.depth_func(GL_ALWAYS);
+
+    m_depth_shader.uniform("u_scene_depth", m_scene_depth, 0);
+    m_depth_shader.uniform("u_downsample", static_cast<int32_t>(m_downsample));
+    renderer.render(GL_TRIANGLES, m_depth_shader, m_quad);
+
+    OGL_CALL(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
+    renderer.depth_func(GL_LESS);
+
+    const float particles_clear[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    OGL_CALL(glClearBufferfv(GL_COLOR, 0, particles_clear));
+
+    // NOTE: color is blended as usual, alpha is accumulated as coverage, so the target holds premultiplied color
+    OGL_CALL(glDepthMask(GL_FALSE));
+    renderer.enable(GL_BLEND);
+    OGL_CALL(glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+}
+
+void particle_low_res::end(const renderer& renderer) const noexcept {
+    OGL_CALL(glDepthMask(GL_TRUE));
+    renderer.blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    framebuffer::bind_default();
+    renderer.viewport(0, 0, m_width, m_height);
+}
+
+void particle_low_res::composite(const renderer& renderer) const noexcept {
+    GLboolean depth_test_enabled;
+    OGL_CALL(glGetBooleanv(GL_DEPTH_TEST, &depth_test_enabled));
+
+    renderer.disable(GL_DEPTH_TEST);
+    renderer.enable(GL_BLEND);
+    renderer.blend_func(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    m_upsample_shader.uniform("u_particles", m_particles, 0);
+    m_upsample_shader.uniform("u_low_res_depth", m_low_res_depth, 1);
+    m_upsample_shader.uniform("u_scene_depth", m_scene_depth, 2);
+    m_upsample_shader.uniform("u_downsample", static_cast<int32_t>(m_downsample));
+    m_upsample_shader.uniform("u_depth_range", glm::vec2(m_near, m_far));
+    renderer.render(GL_TRIANGLES, m_upsample_shader, m_quad);
+
+    renderer.blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    if (depth_test_enabled) {
+        renderer.enable(GL_DEPTH_TEST);
+    }
+}
+
+uint32_t particle_low_res::get_width() const noexcept {
+    return (m_width + m_downsample - 1) / m_downsample;
+}
+
+uint32_t particle_low_res::get_height() const noexcept {
+    return (m_height + m_downsample - 1) / m_downsample;
+}
+
+uint32_t particle_low_res::get_downsample() const noexcept {
+    return m_downsample;
+}
+
+void particle_low_res::_create_targets() noexcept {
+    m_scene_depth.destroy();
+    m_particles.destroy();
+    m_low_res_depth.destroy();
+
+    // NOTE: matches the usual default framebuffer depth format, so the scene depth can be blitted
+    m_scene_depth.create(m_width, m_height, 0, GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8);
+    m_scene_depth.set_parameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    m_scene_depth.set_parameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    m_scene_fbo.attach(GL_DEPTH_STENCIL_ATTACHMENT, 0, m_scene_depth);
+    m_scene_fbo.set_draw_buffer(GL_NONE);
+    m_scene_fbo.set_read_buffer(GL_NONE);
+
+    ASSERT(m_scene_fbo.is_complete(), "particle_low_res", "scene depth framebuffer is incomplete");
+
+    m_particles.create(get_width(), get_height(), 0, GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT);
+    m_particles.set_parameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    m_particles.set_parameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    m_low_res_depth.create(get_width(), get_height(), 0, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_FLOAT);
+    m_low_res_depth.set_parameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    m_low_res_depth.set_parameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    m_low_res_fbo.attach(GL_COLOR_ATTACHMENT0, 0, m_particles);
+    m_low_res_fbo.attach(GL_DEPTH_ATTACHMENT, 0, m_low_res_depth);
+    m_low_res_fbo.set_draw_buffer(GL_COLOR_ATTACHMENT0);
+
+    ASSERT(m_low_res_fbo.is_complete(), "particle_low_res", "low resolution framebuffer is incomplete");
+}
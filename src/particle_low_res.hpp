@@ -0,0 +1,59 @@
+#pragma once
+#include "framebuffer.hpp"
+#include "texture.hpp"
+#include "shader.hpp"
+#include "mesh.hpp"
+
+#include "nocopyable.hpp"
+
+class renderer;
+
+// Off-screen particles (Cantlay, GPU Gems 3 ch. 23). Particles are drawn into a target downsample times smaller than the screen 
+// in each dimension, tested against the farthest scene depth of every block. The premultiplied result is upsampled over 
+// the scene with weights of the 4 nearest low resolution texels scaled by depth similarity, so edges of the scene geometry don't blur
+class particle_low_res : public nocopyable {
+public:
+    particle_low_res() = default;
+    particle_low_res(uint32_t width, uint32_t height, uint32_t downsample);
+
+    void create(uint32_t width, uint32_t height, uint32_t downsample) noexcept;
+    void destroy() noexcept;
+    void resize(uint32_t width, uint32_t height) noexcept;
+
+    // Near and far planes of the projection the scene is drawn with, used to compare depth linearly
+    void set_depth_range(float near, float far) noexcept;
+
+    // Downsamples depth of the default framebuffer, binds and clears the low resolution target and sets up blending.
+    // Particles must be drawn with particles.frag in between begin() and end()
+    void begin(const renderer& renderer) const noexcept;
+    void end(const renderer& renderer) const noexcept;
+
+    // Upsamples particles over the default framebuffer
+    void composite(const renderer& renderer) const noexcept;
+
+    uint32_t get_width() const noexcept;
+    uint32_t get_height() const noexcept;
+    uint32_t get_downsample() const noexcept;
+
+private:
+    void _create_targets() noexcept;
+
+private:
+    framebuffer m_scene_fbo;
+    texture_2d m_scene_depth;
+
+    framebuffer m_low_res_fbo;
+    texture_2d m_particles;
+    texture_2d m_low_res_depth;
+
+    shader m_depth_shader;
+    shader m_upsample_shader;
+    mesh m_quad;
+
+    float m_near = 0.1f;
+    float m_far = 100.0f;
+
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    uint32_t m_downsample = 1;
+};
@@ -0,0 +1,129 @@
+#include "particle_oit.hpp"
+
+#include "renderer.hpp"
+
+particle_oit::particle_oit(uint32_t width, uint32_t height) {
+    create(width, height);
+}
+
+void particle_oit::create(uint32_t width, uint32_t height) noexcept {
+    ASSERT(width > 0 && height > 0, "particle_oit", "invalid targets size");
+
+    m_width = width;
+    m_height = height;
+
+    m_fbo.create();
+    _create_targets();
+
+    m_composite_shader.create(RESOURCE_DIR "shaders/particles/oit_composite.vert", RESOURCE_DIR "shaders/particles/oit_composite.frag");
+
+    std::vector<mesh::vertex> vertices = {
+        mesh::vertex{glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f)},
+        mesh::vertex{glm::vec3(-1.0f,  1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f)},
+        mesh::vertex{glm::vec3( 1.0f,  1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(1.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f)},
+        mesh::vertex{glm::vec3( 1.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f)},
+    };
+
+    std::vector<uint32_t> indices = {
+        0, 1, 2,
+        0, 2, 3
+    };
+
+    m_quad.create(vertices, indices);
+}
+
+void particle_oit::destroy() noexcept {
+    m_accumulation.destroy();
+    m_revealage.destroy();
+    m_depth.destroy();
+    m_fbo.destroy();
+
+    m_width = m_height = 0;
+}
+
+void particle_oit::resize(uint32_t width, uint32_t height) noexcept {
+    if (width == 0 || height == 0 || (width == m_width && height == m_height)) {
+        return;
+    }
+
+    m_width = width;
+    m_height = height;
+
+    _create_targets();
+}
+
+void particle_oit::begin_accumulation() const noexcept {
+    OGL_CALL(glBlitNamedFramebuffer(0, m_fbo.get_id(), 0, 0, m_width, m_height, 0, 0, m_width, m_height, GL_DEPTH_BUFFER_BIT, GL_NEAREST));
+
+    m_fbo.bind();
+
+    const float accumulation_clear[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    const float revealage_clear[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    OGL_CALL(glClearBufferfv(GL_COLOR, 0, accumulation_clear));
+    OGL_CALL(glClearBufferfv(GL_COLOR, 1, revealage_clear));
+
+    // NOTE: particles are still tested against the scene depth but don't occlude each other
+    OGL_CALL(glDepthMask(GL_FALSE));
+
+    OGL_CALL(glEnable(GL_BLEND));
+    OGL_CALL(glBlendFunci(0, GL_ONE, GL_ONE));
+    OGL_CALL(glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR));
+}
+
+void particle_oit::end_accumulation() const noexcept {
+    OGL_CALL(glDepthMask(GL_TRUE));
+    OGL_CALL(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+
+    framebuffer::bind_default();
+}
+
+void particle_oit::composite(const renderer& renderer) const noexcept {
+    GLboolean depth_test_enabled;
+    OGL_CALL(glGetBooleanv(GL_DEPTH_TEST, &depth_test_enabled));
+
+    renderer.disable(GL_DEPTH_TEST);
+    renderer.enable(GL_BLEND);
+    renderer.blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    m_composite_shader.uniform("u_accumulation", m_accumulation, 0);
+    m_composite_shader.uniform("u_revealage", m_revealage, 1);
+    renderer.render(GL_TRIANGLES, m_composite_shader, m_quad);
+
+    if (depth_test_enabled) {
+        renderer.enable(GL_DEPTH_TEST);
+    }
+}
+
+uint32_t particle_oit::get_width() const noexcept {
+    return m_width;
+}
+
+uint32_t particle_oit::get_height() const noexcept {
+    return m_height;
+}
+
+void particle_oit::_create_targets() noexcept {
+    m_accumulation.destroy();
+    m_revealage.destroy();
+    m_depth.destroy();
+
+    m_accumulation.create(m_width, m_height, 0, GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT);
+    m_accumulation.set_parameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    m_accumulation.set_parameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    m_revealage.create(m_width, m_height, 0, GL_R8, GL_RED, GL_FLOAT);
+    m_revealage.set_parameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    m_revealage.set_parameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    // NOTE: matches the usual default framebuffer depth format, so the scene depth can be blitted
+    m_depth.create(m_width, m_height, GL_DEPTH24_STENCIL8);
+
+    m_fbo.attach(GL_COLOR_ATTACHMENT0, 0, m_accumulation);
+    m_fbo.attach(GL_COLOR_ATTACHMENT1, 0, m_revealage);
+    m_fbo.attach(GL_DEPTH_STENCIL_ATTACHMENT, m_depth);
+
+    const uint32_t draw_buffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    m_fbo.set_draw_buffer(std::size(draw_buffers), draw_buffers);
+
+    ASSERT(m_fbo.is_complete(), "particle_oit", "framebuffer is incomplete");
+}
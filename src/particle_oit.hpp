@@ -0,0 +1,49 @@
+#pragma once
+#include "framebuffer.hpp"
+#include "renderbuffer.hpp"
+#include "texture.hpp"
+#include "shader.hpp"
+#include "mesh.hpp"
+
+#include "nocopyable.hpp"
+
+class renderer;
+
+// Weighted blended order-independent transparency (McGuire, Bavoil 2013). Particles are drawn in any order
+// into accumulation (RGBA16F) and revealage (R8) targets which are resolved over the scene by a fullscreen pass,
+// so particle systems don't need depth sorting
+class particle_oit : public nocopyable {
+public:
+    particle_oit() = default;
+    particle_oit(uint32_t width, uint32_t height);
+
+    void create(uint32_t width, uint32_t height) noexcept;
+    void destroy() noexcept;
+    void resize(uint32_t width, uint32_t height) noexcept;
+
+    // Clears the targets, copies depth of the scene from the default framebuffer and sets up blending. 
+    // Particles must be drawn with particles_oit.frag in between begin_accumulation() and end_accumulation()
+    void begin_accumulation() const noexcept;
+    void end_accumulation() const noexcept;
+
+    // Blends accumulated particles over the default framebuffer
+    void composite(const renderer& renderer) const noexcept;
+
+    uint32_t get_width() const noexcept;
+    uint32_t get_height() const noexcept;
+
+private:
+    void _create_targets() noexcept;
+
+private:
+    framebuffer m_fbo;
+    texture_2d m_accumulation;
+    texture_2d m_revealage;
+    renderbuffer m_depth;
+
+    shader m_composite_shader;
+    mesh m_quad;
+
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+};
@@ -0,0 +1,171 @@
+#include "particle_pool.hpp"
+
+#include "assert.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+
+particle_pool::particle_pool(size_t capacity) {
+    create(capacity);
+}
+
+void particle_pool::create(size_t capacity) noexcept {
+    for (std::vector<float>* stream : { 
+        &position.x, &position.y, &position.z, 
+        &previous_position.x, &previous_position.y, &previous_position.z, 
+        &velocity.x, &velocity.y, &velocity.z, 
+        &rotation, &spawn_delay, &life_remaining, &inv_life_time, &life,
+        &start_color.r, &start_color.g, &start_color.b, &start_color.a,
+        &end_color.r, &end_color.g, &end_color.b, &end_color.a,
+        &color.r, &color.g, &color.b, &color.a,
+        &start_size, &end_size, &size 
+    }) {
+        stream->assign(capacity, 0.0f);
+    }
+    seed.assign(capacity, 0);
+
+    live_count = 0;
+}
+
+size_t particle_pool::allocate(size_t count, size_t& first) noexcept {
+    first = live_count;
+
+    const size_t allocated = std::min(count, capacity() - live_count);
+    live_count += allocated;
+
+    return allocated;
+}
+
+void particle_pool::kill(size_t index) noexcept {
+    ASSERT(index < live_count, "particle_pool", "attempt to kill particle which is not alive");
+
+    _move(index, --live_count);
+}
+
+void particle_pool::update(float dt) noexcept {
+    integrate(0, live_count, dt);
+    compact();
+}
+
+void particle_pool::compact() noexcept {
+    for (size_t i = 0; i < live_count;) {
+        if (life_remaining[i] <= 0.0f) {
+            kill(i);
+        } else {
+            ++i;
+        }
+    }
+}
+
+size_t particle_pool::capacity() const noexcept {
+    return life_remaining.size();
+}
+
+void particle_pool::integrate(size_t begin, size_t end, float dt) noexcept {
+    const simd::type dt_v = simd::set(dt);
+    const simd::type rotation_rate_v = simd::set(0.01f);
+    const simd::type zero_v = simd::set(0.0f);
+
+    size_t i = begin;
+    for (; i + simd::WIDTH <= end; i += simd::WIDTH) {
+        // NOTE: particles spawned during the step are integrated over its part after the spawn only
+        const simd::type spawn_delay_v = simd::load(&spawn_delay[i]);
+        const simd::type step_v = simd::max(simd::sub(dt_v, spawn_delay_v), zero_v);
+        simd::store(&spawn_delay[i], simd::max(simd::sub(spawn_delay_v, dt_v), zero_v));
+
+        const simd::type life_remaining_v = simd::sub(simd::load(&life_remaining[i]), step_v);
+        simd::store(&life_remaining[i], life_remaining_v);
+
+        const simd::type life_v = simd::mul(simd::max(life_remaining_v, zero_v), simd::load(&inv_life_time[i]));
+        simd::store(&life[i], life_v);
+
+        const simd::type x_v = simd::load(&position.x[i]);
+        const simd::type y_v = simd::load(&position.y[i]);
+        const simd::type z_v = simd::load(&position.z[i]);
+        simd::store(&previous_position.x[i], x_v);
+        simd::store(&previous_position.y[i], y_v);
+        simd::store(&previous_position.z[i], z_v);
+        simd::store(&position.x[i], simd::add(x_v, simd::mul(simd::load(&velocity.x[i]), step_v)));
+        simd::store(&position.y[i], simd::add(y_v, simd::mul(simd::load(&velocity.y[i]), step_v)));
+        simd::store(&position.z[i], simd::add(z_v, simd::mul(simd::load(&velocity.z[i]), step_v)));
+
+        simd::store(&rotation[i], simd::add(simd::load(&rotation[i]), simd::mul(rotation_rate_v, step_v)));
+
+        simd::store(&color.r[i], simd::lerp(simd::load(&end_color.r[i]), simd::load(&start_color.r[i]), life_v));
+        simd::store(&color.g[i], simd::lerp(simd::load(&end_color.g[i]), simd::load(&start_color.g[i]), life_v));
+        simd::store(&color.b[i], simd::lerp(simd::load(&end_color.b[i]), simd::load(&start_color.b[i]), life_v));
+        simd::store(&color.a[i], simd::mul(simd::lerp(simd::load(&end_color.a[i]), simd::load(&start_color.a[i]), life_v), life_v));
+
+        simd::store(&size[i], simd::lerp(simd::load(&end_size[i]), simd::load(&start_size[i]), life_v));
+    }
+
+    for (; i < end; ++i) {
+        const float step = std::max(dt - spawn_delay[i], 0.0f);
+        spawn_delay[i] = std::max(spawn_delay[i] - dt, 0.0f);
+
+        life_remaining[i] -= step;
+        life[i] = (life_remaining[i] > 0.0f ? life_remaining[i] : 0.0f) * inv_life_time[i];
+
+        previous_position.x[i] = position.x[i];
+        previous_position.y[i] = position.y[i];
+        previous_position.z[i] = position.z[i];
+        position.x[i] += velocity.x[i] * step;
+        position.y[i] += velocity.y[i] * step;
+        position.z[i] += velocity.z[i] * step;
+
+        rotation[i] += 0.01f * step;
+
+        color.r[i] = end_color.r[i] + (start_color.r[i] - end_color.r[i]) * life[i];
+        color.g[i] = end_color.g[i] + (start_color.g[i] - end_color.g[i]) * life[i];
+        color.b[i] = end_color.b[i] + (start_color.b[i] - end_color.b[i]) * life[i];
+        color.a[i] = (end_color.a[i] + (start_color.a[i] - end_color.a[i]) * life[i]) * life[i];
+
+        size[i] = end_size[i] + (start_size[i] - end_size[i]) * life[i];
+    }
+}
+
+void particle_pool::_move(size_t dst, size_t src) noexcept {
+    if (dst == src) {
+        return;
+    }
+
+    position.x[dst] = position.x[src];
+    position.y[dst] = position.y[src];
+    position.z[dst] = position.z[src];
+
+    previous_position.x[dst] = previous_position.x[src];
+    previous_position.y[dst] = previous_position.y[src];
+    previous_position.z[dst] = previous_position.z[src];
+
+    velocity.x[dst] = velocity.x[src];
+    velocity.y[dst] = velocity.y[src];
+    velocity.z[dst] = velocity.z[src];
+
+    rotation[dst] = rotation[src];
+
+    spawn_delay[dst] = spawn_delay[src];
+    life_remaining[dst] = life_remaining[src];
+    inv_life_time[dst] = inv_life_time[src];
+    life[dst] = life[src];
+
+    start_color.r[dst] = start_color.r[src];
+    start_color.g[dst] = start_color.g[src];
+    start_color.b[dst] = start_color.b[src];
+    start_color.a[dst] = start_color.a[src];
+
+    end_color.r[dst] = end_color.r[src];
+    end_color.g[dst] = end_color.g[src];
+    end_color.b[dst] = end_color.b[src];
+    end_color.a[dst] = end_color.a[src];
+
+    color.r[dst] = color.r[src];
+    color.g[dst] = color.g[src];
+    color.b[dst] = color.b[src];
+    color.a[dst] = color.a[src];
+
+    start_size[dst] = start_size[src];
+    end_size[dst] = end_size[src];
+    size[dst] = size[src];
+
+    seed[dst] = seed[src];
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Per-instance particle data read by particles.vert (std430 ParticleInstance), billboard is built in the shader
+struct particle_instance {
+    float position[3];
+    float size;
+    float rotation;
+    uint32_t color;     // RGBA8
+    uint32_t frame;     // low 16 bits - atlas tile index, blended with the next one, high 16 bits - atlas layer
+    float blend;
+};
+
+constexpr uint32_t PARTICLE_INSTANCE_LAYER_SHIFT = 16;
+constexpr uint32_t PARTICLE_INSTANCE_MAX_LAYER = 0xFFFF;
+
+static_assert(sizeof(particle_instance) == 32, "particle_instance must match ParticleInstance layout");
+
+// Structure-of-arrays particle storage. Live particles are always kept compacted in [0, live_count)
+struct particle_pool {
+    struct vec3_stream {
+        std::vector<float> x, y, z;
+    };
+
+    struct vec4_stream {
+        std::vector<float> r, g, b, a;
+    };
+
+    particle_pool() = default;
+    particle_pool(size_t capacity);
+
+    void create(size_t capacity) noexcept;
+
+    // Allocates up to count consecutive slots right after the live range, so allocation is O(1) and needs no free list.
+    // Returns the number of allocated slots, index of the first one is written into first
+    size_t allocate(size_t count, size_t& first) noexcept;
+    void kill(size_t index) noexcept;
+
+    void update(float dt) noexcept;
+
+    // update() is split into these two steps so that integration of disjoint ranges can run concurrently
+    void integrate(size_t begin, size_t end, float dt) noexcept;
+    void compact() noexcept;
+
+    size_t capacity() const noexcept;
+
+private:
+    void _move(size_t dst, size_t src) noexcept;
+
+public:
+    vec3_stream position;
+    // Position before the last integrate(), used to interpolate between fixed simulation steps
+    vec3_stream previous_position;
+    vec3_stream velocity;
+    std::vector<float> rotation;
+
+    // Time left until the particle is spawned. It doesn't move or age before, integrate() starts it in the middle of the step
+    std::vector<float> spawn_delay;
+    std::vector<float> life_remaining;
+    std::vector<float> inv_life_time;
+    // Normalized remaining life in [0, 1], calculated by update()
+    std::vector<float> life;
+
+    vec4_stream start_color, end_color;
+    // Current color, calculated by update()
+    vec4_stream color;
+
+    std::vector<float> start_size, end_size;
+    // Current size, calculated by update()
+    std::vector<float> size;
+
+    // Random per-particle value which stays the same during its life, e.g. for stable distance LOD decisions
+    std::vector<uint32_t> seed;
+
+    size_t live_count = 0;
+};
@@ -2,13 +2,14 @@
 
 #include "random.hpp"
 
+#include <glm/gtc/packing.hpp>
 #include <glm/gtx/norm.hpp>
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/compatibility.hpp>
 
-#include <map>
-
-particle_system::particle_system(size_t particle_count) {
+particle_system::particle_system(size_t particle_count, backend backend)
+    : m_backend(backend)
+{
     ASSERT(particle_count > 0, "particle_system", "particle_count is equal 0");
 
     std::vector<mesh::vertex> vertices = {
@@ -23,147 +24,583 @@ particle_system::particle_system(size_t particle_count) {
         0, 2, 3
     };
 
-    m_mesh.create(vertices, indices);
+    if (m_backend != backend::HEADLESS) {
+        m_mesh.create(vertices, indices);
+    }
+
+    if (m_backend == backend::GPU) {
+        _create_gpu_backend(particle_count);
+    } else {
+        m_pool.create(particle_count);
+        m_random_values.resize(particle_count);
+        m_sort_entries.reserve(particle_count);
+        m_sort_temp.reserve(particle_count);
 
-    m_pool_index = particle_count - 1;
-    m_particle_pool.resize(particle_count);
+        if (m_backend == backend::CPU) {
+            m_instances_ring.create(GL_SHADER_STORAGE_BUFFER, particle_count * sizeof(particle_instance), sizeof(particle_instance));
+        }
+    }
+}
 
-    m_colors_buffer.create(GL_SHADER_STORAGE_BUFFER, particle_count * sizeof(glm::vec4), sizeof(glm::vec4), GL_STREAM_DRAW, nullptr);
-    m_transforms_buffer.create(GL_SHADER_STORAGE_BUFFER, particle_count * sizeof(glm::mat4), sizeof(glm::mat4), GL_DYNAMIC_DRAW, nullptr);
-    m_offsets_buffer.create(GL_SHADER_STORAGE_BUFFER, particle_count * sizeof(glm::vec4), sizeof(glm::vec4), GL_DYNAMIC_DRAW, nullptr);
-    m_blending_buffer.create(GL_SHADER_STORAGE_BUFFER, particle_count * sizeof(float), sizeof(float), GL_DYNAMIC_DRAW, nullptr);
+void particle_system::update(float dt, const camera& camera, const frustum* frustum) noexcept {
+    simulate(dt, camera, frustum);
+    upload();
 }
 
-namespace util {
-    template <typename V, typename Iterator>
-    static void copy_map_into_buffer(const Iterator& begin, const Iterator& end, V* buffer) {
-        ASSERT(buffer != nullptr, "copy_map_into_buffer", "buffer == nullptr");
-        
-        auto it = begin;
-        for (size_t i = 0; it != end; ++it, ++i) {
-            buffer[i] = it->second;
+void particle_system::simulate(float dt, const camera& camera, const frustum* frustum) noexcept {
+    m_camera_position = camera.position;
+
+    if (m_backend == backend::GPU) {
+        m_gpu_dt = dt;
+        m_gpu_frustum_culling = frustum != nullptr;
+        if (frustum != nullptr) {
+            m_gpu_frustum = *frustum;
         }
+        return;
     }
-}
 
-void particle_system::update(float dt, const camera& camera) noexcept {
-    static std::map<double, glm::mat4> sorted_transforms;
-    sorted_transforms.clear();
-    static std::map<double, glm::vec4> sorted_colors;
-    sorted_colors.clear();
-    static std::map<double, glm::vec4> sorted_offsets;
-    sorted_offsets.clear();
-    static std::map<double, float> sorted_blend_factors;
-    sorted_blend_factors.clear();
-    
-    active_particles_count = 0;
+    size_t step_count = 1;
+    float step_dt = dt;
 
-    const glm::mat4 view = camera.get_view();
+    if (m_fixed_timestep > 0.0f) {
+        // NOTE: time which can't be simulated within MAX_FIXED_STEPS is dropped, otherwise slow frames would make the next ones even slower
+        m_time_accumulator = std::min(m_time_accumulator + dt, m_fixed_timestep * MAX_FIXED_STEPS);
 
-    const glm::dvec3 camera_position = camera.position;
-    
-    for (size_t i = 0; i < m_particle_pool.size(); ++i) {
-        particle_system::particle& particle = m_particle_pool[i];
+        step_count = static_cast<size_t>(m_time_accumulator / m_fixed_timestep);
+        step_dt = m_fixed_timestep;
 
-        if (particle.is_active == false) {
-            continue;
+        m_time_accumulator -= step_count * m_fixed_timestep;
+        m_interpolation_factor = m_time_accumulator / m_fixed_timestep;
+    }
+
+    for (size_t step = 0; step < step_count; ++step) {
+        if (m_interaction.radius > 0.0f) {
+            _apply_interaction(step_dt);
         }
 
-        particle.life_remaining -= dt;
+        parallel_for(m_thread_pool, m_pool.live_count, PARALLEL_GRAIN_SIZE, [this, step_dt](size_t begin, size_t end) {
+            _apply_force_fields(begin, end, step_dt);
+            m_pool.integrate(begin, end, step_dt);
+        });
+        m_pool.compact();
+    }
+
+    active_particles_count = m_pool.live_count;
+    m_visible_count = m_pool.live_count;
+    m_use_sort_entries = false;
 
-        if (particle.life_remaining <= 0.0f) {
-            particle.is_active = false;
-            continue;
-        }
+    if (active_particles_count == 0 || m_is_batched) {
+        return;
+    }
 
-        ++active_particles_count;
-
-        particle.position += particle.velocity * dt;
-        particle.rotation += 0.01f * dt;
-
-        const glm::dvec3 particle_to_camera_vector = camera_position - glm::dvec3(particle.position);
-        const glm::vec3 particle_to_camera_unit_vector = glm::normalize(particle_to_camera_vector);
-        const double particle_to_camera_distance = glm::length2(particle_to_camera_vector) * 1'000'000.0;
-
-        const float life = particle.life_remaining / particle.life_time;
-        glm::vec4 color = glm::lerp(particle.end_color, particle.start_color, life);
-        color.a *= life;
-        
-        sorted_colors.insert_or_assign(particle_to_camera_distance, color);
-        
-        const float bias = glm::max(1.0f * (1.0f - glm::dot(-camera.get_forward(), -particle_to_camera_unit_vector)), 0.1f);
-        glm::mat4 transform = glm::translate(glm::mat4(1.0f), particle.position + particle_to_camera_unit_vector * bias);
-        for (size_t y = 0; y < 3; ++y) {
-            for (size_t x = 0; x < 3; ++x) {
-                transform[y][x] = view[x][y];
-            }
-        }
-        const float size = glm::lerp(particle.end_size, particle.start_size, life);
-        transform *= glm::rotate(glm::mat4(1.0f), particle.rotation, glm::vec3(0.0f, 0.0f, 1.0f))
-            * glm::scale(glm::mat4(1.0f), glm::vec3(size, size, 1.0f));
+    if (!m_depth_sorting && frustum == nullptr && !_is_thinning_enabled()) {
+        return;
+    }
 
-        sorted_transforms.insert_or_assign(particle_to_camera_distance, transform);
+    m_sort_entries.resize(m_pool.live_count);
+    active_particles_count = _collect_visible(m_camera_position, frustum, 0, m_sort_entries.data());
+    m_sort_entries.resize(active_particles_count);
+    m_use_sort_entries = true;
 
-        const uint32_t tiles_count = m_atlas_dimension.x * m_atlas_dimension.y;
-        const float atlas_progression = (1.0f - life) * (tiles_count - 1);
-        const uint32_t tile_index1 = glm::floor(atlas_progression);
-        const uint32_t tile_index2 = tile_index1 < tiles_count - 1 ? tile_index1 + 1 : tile_index1;
-        const float tile_width = 1.0f / m_atlas_dimension.x, tile_heigth = 1.0f / m_atlas_dimension.y;
-        const uint32_t tiles_in_raw = m_atlas_dimension.x;
-        sorted_offsets.insert_or_assign(particle_to_camera_distance, glm::vec4(
-            tile_index1 % tiles_in_raw * tile_width,
-            tile_index1 / tiles_in_raw * tile_heigth,
-            tile_index2 % tiles_in_raw * tile_width,
-            tile_index2 / tiles_in_raw * tile_heigth
-        ));
+    if (m_depth_sorting) {
+        radix_sort(m_sort_entries, m_sort_temp);
+    }
+}
 
-        sorted_blend_factors.insert_or_assign(particle_to_camera_distance, atlas_progression - (float)tile_index1);
+void particle_system::upload() noexcept {
+    if (m_backend == backend::GPU) {
+        _upload_gpu();
+        return;
     }
 
-    if (active_particles_count > 0) {
-        util::copy_map_into_buffer(sorted_colors.rbegin(), sorted_colors.rend(), (glm::vec4*)m_colors_buffer.map(GL_WRITE_ONLY));
-        util::copy_map_into_buffer(sorted_transforms.rbegin(), sorted_transforms.rend(), (glm::mat4*)m_transforms_buffer.map(GL_WRITE_ONLY));
-        util::copy_map_into_buffer(sorted_offsets.rbegin(), sorted_offsets.rend(), (glm::vec4*)m_offsets_buffer.map(GL_WRITE_ONLY));
-        util::copy_map_into_buffer(sorted_blend_factors.rbegin(), sorted_blend_factors.rend(), (float*)m_blending_buffer.map(GL_WRITE_ONLY));
-        
-        assert(m_colors_buffer.unmap());
-        assert(m_transforms_buffer.unmap());
-        assert(m_offsets_buffer.unmap());
-        assert(m_blending_buffer.unmap());
+    if (m_backend == backend::HEADLESS || active_particles_count == 0 || m_is_batched) {
+        return;
     }
+
+    write_instances(static_cast<particle_instance*>(m_instances_ring.next_region()));
 }
 
-void particle_system::emit(const particle_props &props) noexcept {
-    particle& particle = m_particle_pool[m_pool_index];
-    
-    particle.is_active = true;
-    particle.position = props.position;
-    particle.rotation = random(0.0f, 1.0f) * 2.0f * glm::pi<float>();
+void particle_system::write_instances(particle_instance* instances) const noexcept {
+    ASSERT(m_backend != backend::GPU, "particle_system", "GPU backend instances are written by compute shader");
 
-    particle.velocity = props.velocity;
-    particle.velocity.x += props.velocity_variation.x * (random(-10.0f, 10.0f) / 10.0f);
-    particle.velocity.y += props.velocity_variation.y * (random(-10.0f, 10.0f) / 10.0f);
-    particle.velocity.z += props.velocity_variation.z * (random(-10.0f, 10.0f) / 10.0f);
+    // NOTE: every range writes its own slice of the mapped region, so no further merging is needed
+    parallel_for(m_thread_pool, active_particles_count, PARALLEL_GRAIN_SIZE, [this, instances](size_t begin, size_t end) {
+        _write_instances(begin, end, instances);
+    });
+}
 
-    particle.start_color = props.start_color;
-    particle.end_color = props.end_color;
+void particle_system::emit(const particle_props& props, size_t count, float first_delay, float delay_step) noexcept {
+    if (count == 0) {
+        return;
+    }
 
-    particle.life_time = props.life_time;
-    particle.life_remaining = props.life_time;
-    particle.start_size = props.start_size + props.size_variation * (random(-10.0f, 10.0f) / 10.0f);
-    particle.end_size = props.end_size;
+    m_requested_emit_count += count;
+    m_last_emit_position = props.position;
 
-    m_pool_index = --m_pool_index % m_particle_pool.size();
+    if (m_backend == backend::GPU) {
+        _emit_gpu(props, count, first_delay, delay_step);
+        return;
+    }
+
+    if (m_pool.live_count >= m_budget_live_limit) {
+        return;
+    }
+    count = std::min(count, m_budget_live_limit - m_pool.live_count);
+
+    size_t first;
+    count = m_pool.allocate(count, first);
+    if (count == 0) {
+        return;
+    }
+
+    const size_t last = first + count;
+    float* random_values = m_random_values.data();
+    random_generator& generator = thread_random();
+
+    std::fill(m_pool.position.x.begin() + first, m_pool.position.x.begin() + last, props.position.x);
+    std::fill(m_pool.position.y.begin() + first, m_pool.position.y.begin() + last, props.position.y);
+    std::fill(m_pool.position.z.begin() + first, m_pool.position.z.begin() + last, props.position.z);
+
+    generator.fill(m_pool.rotation.data() + first, count, 0.0f, 2.0f * glm::pi<float>());
+
+    generator.fill(random_values, count, -1.0f, 1.0f);
+    for (size_t i = 0; i < count; ++i) {
+        m_pool.velocity.x[first + i] = props.velocity.x + props.velocity_variation.x * random_values[i];
+    }
+    generator.fill(random_values, count, -1.0f, 1.0f);
+    for (size_t i = 0; i < count; ++i) {
+        m_pool.velocity.y[first + i] = props.velocity.y + props.velocity_variation.y * random_values[i];
+    }
+    generator.fill(random_values, count, -1.0f, 1.0f);
+    for (size_t i = 0; i < count; ++i) {
+        m_pool.velocity.z[first + i] = props.velocity.z + props.velocity_variation.z * random_values[i];
+    }
+
+    std::fill(m_pool.start_color.r.begin() + first, m_pool.start_color.r.begin() + last, props.start_color.r);
+    std::fill(m_pool.start_color.g.begin() + first, m_pool.start_color.g.begin() + last, props.start_color.g);
+    std::fill(m_pool.start_color.b.begin() + first, m_pool.start_color.b.begin() + last, props.start_color.b);
+    std::fill(m_pool.start_color.a.begin() + first, m_pool.start_color.a.begin() + last, props.start_color.a);
+    std::fill(m_pool.end_color.r.begin() + first, m_pool.end_color.r.begin() + last, props.end_color.r);
+    std::fill(m_pool.end_color.g.begin() + first, m_pool.end_color.g.begin() + last, props.end_color.g);
+    std::fill(m_pool.end_color.b.begin() + first, m_pool.end_color.b.begin() + last, props.end_color.b);
+    std::fill(m_pool.end_color.a.begin() + first, m_pool.end_color.a.begin() + last, props.end_color.a);
+
+    std::fill(m_pool.life_remaining.begin() + first, m_pool.life_remaining.begin() + last, props.life_time);
+    std::fill(m_pool.inv_life_time.begin() + first, m_pool.inv_life_time.begin() + last, 1.0f / props.life_time);
+    std::fill(m_pool.end_size.begin() + first, m_pool.end_size.begin() + last, props.end_size);
+
+    generator.fill(random_values, count, -1.0f, 1.0f);
+    for (size_t i = 0; i < count; ++i) {
+        m_pool.start_size[first + i] = props.start_size + props.size_variation * random_values[i];
+    }
+
+    generator.fill(m_pool.seed.data() + first, count);
+
+    // NOTE: delays are counted from the beginning of the dt passed to the next simulate(). Fixed steps have already simulated
+    // the time in the accumulator, so the step which spawns the particle is found by integrate() itself
+    const float time_offset = m_fixed_timestep > 0.0f ? m_time_accumulator : 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+        m_pool.spawn_delay[first + i] = time_offset + first_delay + delay_step * static_cast<float>(i);
+    }
+
+    // NOTE: new particles have no previous step, so they aren't interpolated until the next one
+    std::copy(m_pool.position.x.begin() + first, m_pool.position.x.begin() + last, m_pool.previous_position.x.begin() + first);
+    std::copy(m_pool.position.y.begin() + first, m_pool.position.y.begin() + last, m_pool.previous_position.y.begin() + first);
+    std::copy(m_pool.position.z.begin() + first, m_pool.position.z.begin() + last, m_pool.previous_position.z.begin() + first);
 }
 
 void particle_system::bind_buffers() const noexcept {
-    m_transforms_buffer.bind_base(0);
-    m_colors_buffer.bind_base(1);
-    m_offsets_buffer.bind_base(2);
-    m_blending_buffer.bind_base(3);
+    if (m_backend == backend::GPU) {
+        m_instances_buffer.bind_base(0);
+    } else {
+        m_instances_ring.bind_range(0);
+    }
+}
+
+void particle_system::set_depth_sorting(bool enabled) noexcept {
+    m_depth_sorting = enabled;
+}
+
+void particle_system::set_distance_lod(float start_distance, float min_density) noexcept {
+    m_lod_start_distance2 = start_distance > 0.0f ? start_distance * start_distance : 0.0f;
+    m_lod_min_density = glm::clamp(min_density, 0.01f, 1.0f);
+}
+
+void particle_system::set_fixed_timestep(float timestep) noexcept {
+    m_fixed_timestep = std::max(timestep, 0.0f);
+    m_time_accumulator = 0.0f;
+    m_interpolation_factor = 1.0f;
+}
+
+void particle_system::set_vector_field(const vector_field* field, float strength) noexcept {
+    m_vector_field = field;
+    m_vector_field_strength = strength;
+}
+
+void particle_system::set_curl_noise(const curl_noise* noise, float strength) noexcept {
+    m_curl_noise = noise;
+    m_curl_noise_strength = strength;
+}
+
+void particle_system::set_particle_interaction(const particle_interaction& interaction) noexcept {
+    m_interaction = interaction;
+    if (m_interaction.radius > 0.0f) {
+        m_spatial_hash.create(m_interaction.radius);
+    }
+}
+
+void particle_system::set_thread_pool(thread_pool* pool) noexcept {
+    m_thread_pool = pool;
+}
+
+particle_system::backend particle_system::get_backend() const noexcept {
+    return m_backend;
+}
+
+size_t particle_system::get_live_count() const noexcept {
+    return m_pool.live_count;
+}
+
+size_t particle_system::get_instance_count() const noexcept {
+    return active_particles_count;
 }
 
 void particle_system::set_texture_atlas_dimension(uint32_t raws, uint32_t columns) noexcept {
     m_atlas_dimension.x = columns > 0 ? columns : 1;
     m_atlas_dimension.y = raws > 0 ? raws : 1;
 }
+
+void particle_system::set_texture_atlas_layer(uint32_t layer) noexcept {
+    ASSERT(layer <= PARTICLE_INSTANCE_MAX_LAYER, "particle_system", "atlas layer is out of range");
+    m_atlas_layer = layer;
+}
+
+
+void particle_system::_apply_force_fields(size_t begin, size_t end, float dt) noexcept {
+    const float* x = m_pool.position.x.data() + begin;
+    const float* y = m_pool.position.y.data() + begin;
+    const float* z = m_pool.position.z.data() + begin;
+
+    float* velocity_x = m_pool.velocity.x.data() + begin;
+    float* velocity_y = m_pool.velocity.y.data() + begin;
+    float* velocity_z = m_pool.velocity.z.data() + begin;
+
+    if (m_vector_field != nullptr) {
+        m_vector_field->accumulate(x, y, z, end - begin, m_vector_field_strength * dt, velocity_x, velocity_y, velocity_z);
+    }
+
+    if (m_curl_noise != nullptr) {
+        m_curl_noise->accumulate(x, y, z, end - begin, m_curl_noise_strength * dt, velocity_x, velocity_y, velocity_z);
+    }
+}
+
+void particle_system::_apply_interaction(float dt) noexcept {
+    const size_t count = m_pool.live_count;
+    if (count == 0) {
+        return;
+    }
+
+    const float* x = m_pool.position.x.data();
+    const float* y = m_pool.position.y.data();
+    const float* z = m_pool.position.z.data();
+
+    m_spatial_hash.build(x, y, z, count, m_thread_pool);
+    m_densities.resize(count);
+
+    const float radius = m_interaction.radius;
+    const float radius2 = radius * radius;
+    const float inv_radius = 1.0f / radius;
+
+    parallel_for(m_thread_pool, count, PARALLEL_GRAIN_SIZE, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const glm::vec3 position(x[i], y[i], z[i]);
+
+            float density = 0.0f;
+            m_spatial_hash.for_each_candidate(position, [&](uint32_t j) {
+                const glm::vec3 offset(position.x - x[j], position.y - y[j], position.z - z[j]);
+                const float distance2 = glm::dot(offset, offset);
+                if (distance2 < radius2) {
+                    const float q = 1.0f - std::sqrt(distance2) * inv_radius;
+                    density += q * q;
+                }
+            });
+
+            m_densities[i] = density;
+        }
+    });
+
+    // NOTE: positions and densities are read only, every particle writes its own velocity, so ranges don't race
+    parallel_for(m_thread_pool, count, PARALLEL_GRAIN_SIZE, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const glm::vec3 position(x[i], y[i], z[i]);
+            const float density = m_densities[i];
+
+            glm::vec3 acceleration(0.0f);
+            m_spatial_hash.for_each_candidate(position, [&](uint32_t j) {
+                const glm::vec3 offset(position.x - x[j], position.y - y[j], position.z - z[j]);
+                const float distance2 = glm::dot(offset, offset);
+                if (j == i || distance2 >= radius2 || distance2 == 0.0f) {
+                    return;
+                }
+
+                const float distance = std::sqrt(distance2);
+                const glm::vec3 direction = offset / distance;
+                const float q = 1.0f - distance * inv_radius;
+
+                const float pressure = m_interaction.pressure * (density + m_densities[j] - 2.0f * m_interaction.rest_density);
+
+                acceleration += direction * (m_interaction.separation * q * q + pressure * q - m_interaction.cohesion * q * (1.0f - q));
+            });
+
+            m_pool.velocity.x[i] += acceleration.x * dt;
+            m_pool.velocity.y[i] += acceleration.y * dt;
+            m_pool.velocity.z[i] += acceleration.z * dt;
+        }
+    });
+}
+
+size_t particle_system::_collect_visible(const glm::vec3& camera_position, const frustum* frustum, uint32_t index_bits, sort_entry* entries) noexcept {
+    m_camera_position = camera_position;
+
+    const bool lod_enabled = _is_thinning_enabled();
+
+    // NOTE: every chunk is compacted into its own place first, chunks are merged afterwards
+    const size_t chunk_count = (m_pool.live_count + PARALLEL_GRAIN_SIZE - 1) / PARALLEL_GRAIN_SIZE;
+    m_chunk_visible_counts.resize(chunk_count);
+
+    parallel_for(m_thread_pool, chunk_count, 1, [&](size_t begin_chunk, size_t end_chunk) {
+        for (size_t chunk = begin_chunk; chunk < end_chunk; ++chunk) {
+            const size_t begin = chunk * PARALLEL_GRAIN_SIZE;
+            const size_t end = std::min(begin + PARALLEL_GRAIN_SIZE, m_pool.live_count);
+
+            size_t visible_count = 0;
+            for (size_t i = begin; i < end; ++i) {
+                if (m_pool.spawn_delay[i] > 0.0f) {
+                    continue;
+                }
+
+                const glm::vec3 position = _get_drawn_position(i);
+
+                // NOTE: rotated billboard fits into the sphere of size * sqrt(2) radius
+                if (frustum != nullptr && !frustum->is_sphere_visible(position, m_pool.size[i] * 1.41421356f)) {
+                    continue;
+                }
+
+                const float particle_to_camera_distance = glm::length2(camera_position - position);
+
+                // NOTE: seed is uniform in [0, 2^32), so the particle is kept with the probability equal density
+                if (lod_enabled && m_pool.seed[i] * (1.0f / 4294967296.0f) >= _get_lod_density(particle_to_camera_distance)) {
+                    continue;
+                }
+
+                // NOTE: inverted key, so that ascending sort gives back-to-front order
+                entries[begin + visible_count++] = sort_entry{ ~float_to_sort_key(particle_to_camera_distance), index_bits | static_cast<uint32_t>(i) };
+            }
+
+            m_chunk_visible_counts[chunk] = visible_count;
+        }
+    });
+
+    size_t visible_count = 0;
+    for (size_t chunk = 0; chunk < chunk_count; ++chunk) {
+        const size_t begin = chunk * PARALLEL_GRAIN_SIZE;
+        if (visible_count != begin) {
+            memmove(entries + visible_count, entries + begin, m_chunk_visible_counts[chunk] * sizeof(sort_entry));
+        }
+        visible_count += m_chunk_visible_counts[chunk];
+    }
+
+    m_visible_count = visible_count;
+    return visible_count;
+}
+
+glm::vec3 particle_system::_get_drawn_position(size_t index) const noexcept {
+    const float t = m_interpolation_factor;
+    return glm::vec3(
+        m_pool.previous_position.x[index] + (m_pool.position.x[index] - m_pool.previous_position.x[index]) * t,
+        m_pool.previous_position.y[index] + (m_pool.position.y[index] - m_pool.previous_position.y[index]) * t,
+        m_pool.previous_position.z[index] + (m_pool.position.z[index] - m_pool.previous_position.z[index]) * t
+    );
+}
+
+bool particle_system::_is_distance_lod_enabled() const noexcept {
+    return m_lod_start_distance2 > 0.0f && m_lod_min_density < 1.0f;
+}
+
+bool particle_system::_is_thinning_enabled() const noexcept {
+    return _is_distance_lod_enabled() || m_budget_density < 1.0f;
+}
+
+float particle_system::_get_lod_density(float distance2) const noexcept {
+    if (!_is_distance_lod_enabled() || distance2 <= m_lod_start_distance2) {
+        return m_budget_density;
+    }
+    return std::max(m_lod_min_density, m_lod_start_distance2 / distance2) * m_budget_density;
+}
+
+void particle_system::_set_budget(size_t live_limit, float density) noexcept {
+    m_budget_live_limit = live_limit;
+    m_budget_density = glm::clamp(density, 0.01f, 1.0f);
+}
+
+void particle_system::_write_instances(size_t begin, size_t end, particle_instance* instances) const noexcept {
+    if (m_use_sort_entries) {
+        for (size_t i = begin; i < end; ++i) {
+            _write_instance(m_sort_entries[i].index, instances[i]);
+        }
+    } else {
+        for (size_t i = begin; i < end; ++i) {
+            _write_instance(i, instances[i]);
+        }
+    }
+}
+
+void particle_system::_write_instance(size_t index, particle_instance& instance) const noexcept {
+    const float tiles_count = m_atlas_dimension.x * m_atlas_dimension.y;
+
+    const glm::vec3 position = _get_drawn_position(index);
+    instance.position[0] = position.x;
+    instance.position[1] = position.y;
+    instance.position[2] = position.z;
+    // NOTE: particles which aren't spawned yet are written only when nothing is culled, they are collapsed then
+    instance.size = m_pool.spawn_delay[index] > 0.0f ? 0.0f : m_pool.size[index];
+    instance.rotation = m_pool.rotation[index];
+
+    glm::vec4 color(m_pool.color.r[index], m_pool.color.g[index], m_pool.color.b[index], m_pool.color.a[index]);
+    if (_is_thinning_enabled()) {
+        // NOTE: one kept particle stands for 1 / density particles, so it gets opacity of that many overlapped ones
+        const float density = _get_lod_density(glm::length2(m_camera_position - position));
+        color.a = 1.0f - std::pow(1.0f - color.a, 1.0f / density);
+    }
+    instance.color = glm::packUnorm4x8(color);
+
+    const float atlas_progression = (1.0f - m_pool.life[index]) * (tiles_count - 1.0f);
+    const uint32_t frame = static_cast<uint32_t>(atlas_progression);
+    instance.frame = frame | (m_atlas_layer << PARTICLE_INSTANCE_LAYER_SHIFT);
+    instance.blend = atlas_progression - static_cast<float>(frame);
+}
+
+void particle_system::_create_gpu_backend(size_t particle_count) noexcept {
+    ASSERT(particle_count <= std::numeric_limits<uint32_t>::max(), "particle_system", "particle_count is too big for GPU backend");
+
+    m_emit_shader.create(RESOURCE_DIR "shaders/particles/emit.comp");
+    m_update_shader.create(RESOURCE_DIR "shaders/particles/update.comp");
+
+    // NOTE: zero remaining life marks particle as dead
+    const std::vector<gpu_particle> particles(particle_count, gpu_particle{});
+    m_instances_buffer.create(GL_SHADER_STORAGE_BUFFER, particle_count * sizeof(particle_instance), sizeof(particle_instance), GL_DYNAMIC_COPY, nullptr);
+    m_particles_buffer.create(GL_SHADER_STORAGE_BUFFER, particle_count * sizeof(gpu_particle), sizeof(gpu_particle), GL_DYNAMIC_COPY, particles.data());
+    m_emit_requests_buffer.create(GL_SHADER_STORAGE_BUFFER, MAX_GPU_EMIT_REQUESTS * sizeof(gpu_emit_request), sizeof(gpu_emit_request), GL_STREAM_DRAW, nullptr);
+
+    // NOTE: all particles are dead at first
+    std::vector<uint32_t> dead_indices(particle_count + 1);
+    dead_indices[0] = static_cast<uint32_t>(particle_count);
+    for (size_t i = 0; i < particle_count; ++i) {
+        dead_indices[i + 1] = static_cast<uint32_t>(i);
+    }
+    m_dead_indices_buffer.create(GL_SHADER_STORAGE_BUFFER, dead_indices.size() * sizeof(uint32_t), sizeof(uint32_t), GL_DYNAMIC_COPY, dead_indices.data());
+
+    const draw_elements_indirect_command command = { static_cast<uint32_t>(m_mesh.ibo.get_element_count()), 0, 0, 0, 0 };
+    m_draw_command_buffer.create(GL_DRAW_INDIRECT_BUFFER, sizeof(command), sizeof(command), GL_DYNAMIC_COPY, &command);
+
+    m_gpu_emit_requests.reserve(MAX_GPU_EMIT_REQUESTS);
+}
+
+void particle_system::_emit_gpu(const particle_props& props, size_t count, float first_delay, float delay_step) noexcept {
+    gpu_emit_request request;
+    request.position = glm::vec4(props.position, 0.0f);
+    request.velocity = glm::vec4(props.velocity, 0.0f);
+    request.velocity_variation = glm::vec4(props.velocity_variation, 0.0f);
+    request.start_color = props.start_color;
+    request.end_color = props.end_color;
+    request.size_life = glm::vec4(props.start_size, props.end_size, props.size_variation, props.life_time);
+    request.delay = glm::vec4(first_delay, delay_step, 0.0f, 0.0f);
+    request.range = glm::uvec4(0, std::min<size_t>(count, std::numeric_limits<uint32_t>::max()), thread_random().next_u32(), 0);
+
+    // NOTE: sequential emits with the same props are merged into one request, spread spawn times can't be merged
+    if (!m_gpu_emit_requests.empty() && delay_step == 0.0f) {
+        gpu_emit_request& last = m_gpu_emit_requests.back();
+        if (memcmp(&last, &request, offsetof(gpu_emit_request, range)) == 0) {
+            last.range.y += request.range.y;
+            return;
+        }
+    }
+
+    m_gpu_emit_requests.emplace_back(request);
+}
+
+void particle_system::_upload_gpu() noexcept {
+    const uint32_t capacity = m_particles_buffer.get_element_count();
+
+    m_particles_buffer.bind_base(5);
+    m_dead_indices_buffer.bind_base(7);
+
+    for (size_t first = 0; first < m_gpu_emit_requests.size(); first += MAX_GPU_EMIT_REQUESTS) {
+        const size_t request_count = std::min(MAX_GPU_EMIT_REQUESTS, m_gpu_emit_requests.size() - first);
+
+        uint32_t emit_count = 0;
+        for (size_t i = first; i < first + request_count; ++i) {
+            m_gpu_emit_requests[i].range.x = emit_count;
+            emit_count += m_gpu_emit_requests[i].range.y;
+        }
+        // NOTE: emit.comp drops particles which find no dead ones left, so the emitted count is clamped to the dead count there
+        emit_count = std::min(emit_count, capacity);
+
+        m_emit_requests_buffer.subdata(0, request_count * sizeof(gpu_emit_request), &m_gpu_emit_requests[first]);
+        m_emit_requests_buffer.bind_base(6);
+
+        m_emit_shader.uniform("u_request_count", static_cast<uint32_t>(request_count));
+        m_emit_shader.uniform("u_emit_count", emit_count);
+        m_emit_shader.uniform("u_capacity", capacity);
+
+        OGL_CALL(glDispatchCompute((emit_count + 63) / 64, 1, 1));
+        OGL_CALL(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT));
+    }
+    m_gpu_emit_requests.clear();
+
+    const uint32_t instance_count = 0;
+    m_draw_command_buffer.subdata(offsetof(draw_elements_indirect_command, instance_count), sizeof(instance_count), &instance_count);
+    m_draw_command_buffer.bind_base(GL_SHADER_STORAGE_BUFFER, 4);
+
+    bind_buffers();
+
+    m_update_shader.uniform("u_dt", m_gpu_dt);
+    m_update_shader.uniform("u_capacity", capacity);
+    m_update_shader.uniform("u_atlas_dimension", m_atlas_dimension);
+    m_update_shader.uniform("u_atlas_layer", m_atlas_layer);
+
+    m_update_shader.uniform("u_frustum_culling", m_gpu_frustum_culling);
+    if (m_gpu_frustum_culling) {
+        for (uint32_t i = 0; i < frustum::PLANE_COUNT; ++i) {
+            m_update_shader.uniform("u_frustum_planes[" + std::to_string(i) + "]", m_gpu_frustum.get_plane(static_cast<frustum::plane>(i)));
+        }
+    }
+
+    m_update_shader.uniform("u_camera_position", m_camera_position);
+    m_update_shader.uniform("u_lod_start_distance2", _is_distance_lod_enabled() ? m_lod_start_distance2 : 0.0f);
+    m_update_shader.uniform("u_lod_min_density", m_lod_min_density);
+
+    OGL_CALL(glDispatchCompute((capacity + 255) / 256, 1, 1));
+    OGL_CALL(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT));
+}
+
+particle_emitter::particle_emitter(const particle_props& props, float rate)
+    : props(props), rate(rate)
+{
+}
+
+void particle_emitter::update(float dt, particle_system& system) noexcept {
+    if (rate <= 0.0f || dt <= 0.0f) {
+        return;
+    }
+
+    // NOTE: accumulator keeps fraction of the next particle, it is spawned once the fraction reaches 1
+    const float start_fraction = m_accumulator;
+    m_accumulator += rate * dt;
+
+    const float count = std::floor(m_accumulator);
+    m_accumulator -= count;
+
+    const float interval = 1.0f / rate;
+    system.emit(props, static_cast<size_t>(count), (1.0f - start_fraction) * interval, interval);
+}
\ No newline at end of file
@@ -1,8 +1,17 @@
 #pragma once
 #include <vector>
+#include <limits>
 
 #include "mesh.hpp"
 #include "camera.hpp"
+#include "frustum.hpp"
+#include "vector_field.hpp"
+#include "curl_noise.hpp"
+#include "spatial_hash.hpp"
+#include "particle_pool.hpp"
+#include "radix_sort.hpp"
+#include "ring_buffer.hpp"
+#include "thread_pool.hpp"
 
 struct particle_props {
     glm::vec3 position;
@@ -12,41 +21,218 @@ struct particle_props {
     float life_time = 1.0f;
 };
 
+// Particle-particle forces between neighbours closer than radius, weighted by q = 1 - distance / radius:
+// separation pushes apart by q^2, pressure pushes from dense areas by local density excess, cohesion pulls at mid-range
+struct particle_interaction {
+    float radius = 0.0f;
+    float separation = 0.0f;
+    float pressure = 0.0f;
+    float rest_density = 1.0f;
+    float cohesion = 0.0f;
+};
+
 class particle_system {
     friend class renderer;
+    friend class particle_batch;
+    friend class particle_budget;
+public:
+    // CPU - simulation, sorting and instance data generation on CPU, instance data is uploaded every frame.
+    // GPU - particles state lives in SSBOs and is simulated by compute shaders, no sorting
+    // HEADLESS - CPU without any OpenGL objects, instances are generated by write_instances() only. Doesn't need OpenGL context
+    enum class backend { CPU, GPU, HEADLESS };
+
 public:
-    particle_system(size_t particle_count);
+    particle_system(size_t particle_count, backend backend = backend::CPU);
+
+    // Particles outside of frustum aren't sorted and drawn, nullptr disables culling
+    void update(float dt, const camera& camera, const frustum* frustum = nullptr) noexcept;
+
+    // update() split into two steps. simulate() doesn't touch OpenGL and may be called for different systems concurrently,
+    // upload() must be called from the thread which owns the OpenGL context
+    void simulate(float dt, const camera& camera, const frustum* frustum = nullptr) noexcept;
+    void upload() noexcept;
 
-    void update(float dt, const camera& camera) noexcept;
-    void emit(const particle_props& props) noexcept;
+    // Writes get_instance_count() instances of particles to be drawn in the order they are drawn. CPU and HEADLESS backends only
+    void write_instances(particle_instance* instances) const noexcept;
+
+    // Emits up to count particles at once, particles which don't fit into the pool are dropped.
+    // i-th particle is spawned first_delay + i * delay_step seconds after the beginning of dt passed to the next simulate(),
+    // it doesn't move, age or get drawn before
+    void emit(const particle_props& props, size_t count = 1, float first_delay = 0.0f, float delay_step = 0.0f) noexcept;
 
     void bind_buffers() const noexcept; 
 
     void set_texture_atlas_dimension(uint32_t raws, uint32_t columns) noexcept;
+    // Layer of the texture_2d_array the atlas is stored in
+    void set_texture_atlas_layer(uint32_t layer) noexcept;
+
+    // Back-to-front sorting is required by ordinary alpha blending only, disable it when particles are drawn with particle_oit
+    void set_depth_sorting(bool enabled) noexcept;
+
+    // Particles farther than start_distance are kept with probability (start_distance / distance)^2 but not less than min_density.
+    // The kept ones become more opaque, so the overall opacity stays the same. start_distance <= 0 disables it
+    void set_distance_lod(float start_distance, float min_density) noexcept;
+
+    // Simulates in fixed steps of timestep seconds regardless of dt passed to simulate(), at most MAX_FIXED_STEPS per call.
+    // Drawn positions are interpolated between the last two steps. 0 simulates once per simulate() call with its dt.
+    // Ignored by GPU backend
+    void set_fixed_timestep(float timestep) noexcept;
+
+    // Force fields accelerate particles by field value * strength. Fields aren't owned by the system, nullptr disables them.
+    // Ignored by GPU backend
+    void set_vector_field(const vector_field* field, float strength = 1.0f) noexcept;
+    void set_curl_noise(const curl_noise* noise, float strength = 1.0f) noexcept;
+
+    // Neighbours are found with a spatial hash rebuilt every simulation step. Zero radius disables it. Ignored by GPU backend
+    void set_particle_interaction(const particle_interaction& interaction) noexcept;
+
+    // Splits simulation and instance data generation into ranges processed by the pool workers. nullptr disables it
+    void set_thread_pool(thread_pool* pool) noexcept;
+
+    backend get_backend() const noexcept;
+    // Counts after the last simulate() call. Unknown on CPU for GPU backend
+    size_t get_live_count() const noexcept;
+    size_t get_instance_count() const noexcept;
 
 private:
-    struct particle {
-        glm::vec3 position;
-        glm::vec3 velocity;
-        glm::vec4 start_color, end_color;
-        float start_size, end_size;
-        float rotation = 0.0f;
-        float life_time = 1.0f;
-        float life_remaining = 0.0f;
-
-        bool is_active = false;
+    void _create_gpu_backend(size_t particle_count) noexcept;
+    void _emit_gpu(const particle_props& props, size_t count, float first_delay, float delay_step) noexcept;
+    void _upload_gpu() noexcept;
+
+    // Writes sort entries of visible particles into entries (live_count at most) and returns their count.
+    // index_bits are combined with particle indices, particle_batch keeps system index there
+    size_t _collect_visible(const glm::vec3& camera_position, const frustum* frustum, uint32_t index_bits, sort_entry* entries) noexcept;
+    // Position between the last two simulation steps the particle is drawn at, culling and sorting use it too
+    glm::vec3 _get_drawn_position(size_t index) const noexcept;
+    bool _is_distance_lod_enabled() const noexcept;
+    // Distance LOD or budget decimation drops some of the visible particles
+    bool _is_thinning_enabled() const noexcept;
+    float _get_lod_density(float distance2) const noexcept;
+
+    // Set by particle_budget. Emission stops at live_limit particles, density thins drawn particles like distance LOD does
+    void _set_budget(size_t live_limit, float density) noexcept;
+
+    void _apply_force_fields(size_t begin, size_t end, float dt) noexcept;
+    void _apply_interaction(float dt) noexcept;
+
+    void _write_instances(size_t begin, size_t end, particle_instance* instances) const noexcept;
+    void _write_instance(size_t index, particle_instance& instance) const noexcept;
+
+private:
+    // Matches EmitRequest in emit.comp (std430)
+    struct gpu_emit_request {
+        glm::vec4 position;
+        glm::vec4 velocity;
+        glm::vec4 velocity_variation;
+        glm::vec4 start_color;
+        glm::vec4 end_color;
+        glm::vec4 size_life;
+        glm::vec4 delay;
+        glm::uvec4 range;
+    };
+
+    // Matches Particle in emit.comp and update.comp (std430)
+    struct gpu_particle {
+        glm::vec4 position_life;
+        glm::vec4 velocity_inv_life_time;
+        glm::vec4 start_color;
+        glm::vec4 end_color;
+        glm::vec4 size_rotation;
+        glm::vec4 spawn_delay;
+    };
+
+    struct draw_elements_indirect_command {
+        uint32_t count;
+        uint32_t instance_count;
+        uint32_t first_index;
+        int32_t base_vertex;
+        uint32_t base_instance;
     };
 
-    std::vector<particle> m_particle_pool;
+private:
+    static constexpr size_t PARALLEL_GRAIN_SIZE = 2048;
+    static constexpr size_t MAX_GPU_EMIT_REQUESTS = 64;
+    static constexpr size_t MAX_FIXED_STEPS = 4;
+
+    particle_pool m_pool;
+    std::vector<sort_entry> m_sort_entries;
+    std::vector<sort_entry> m_sort_temp;
+    std::vector<float> m_random_values;
+    std::vector<size_t> m_chunk_visible_counts;
+    // NOTE: false when particles are drawn in the pool order and m_sort_entries aren't used
+    bool m_use_sort_entries = false;
 
     mesh m_mesh;
-    buffer m_colors_buffer;
-    buffer m_transforms_buffer;
-    buffer m_offsets_buffer;
-    buffer m_blending_buffer;
+    // CPU backend streams instances through the ring, GPU backend writes them into the plain buffer by compute shader
+    ring_buffer m_instances_ring;
+    buffer m_instances_buffer;
+
+    shader m_emit_shader;
+    shader m_update_shader;
+    buffer m_particles_buffer;
+    buffer m_emit_requests_buffer;
+    buffer m_draw_command_buffer;
+    // NOTE: count of dead particles followed by their indices, update.comp pushes particles which die and emit.comp pops them
+    buffer m_dead_indices_buffer;
+    std::vector<gpu_emit_request> m_gpu_emit_requests;
+    float m_gpu_dt = 0.0f;
 
     glm::vec2 m_atlas_dimension = glm::vec2(1.0f);
+    uint32_t m_atlas_layer = 0;
+
+    thread_pool* m_thread_pool = nullptr;
+
+    backend m_backend = backend::CPU;
+
+    // NOTE: batched system is sorted and uploaded together with other systems by particle_batch
+    bool m_is_batched = false;
+    bool m_depth_sorting = true;
+
+    const vector_field* m_vector_field = nullptr;
+    const curl_noise* m_curl_noise = nullptr;
+    float m_vector_field_strength = 1.0f;
+    float m_curl_noise_strength = 1.0f;
+
+    particle_interaction m_interaction;
+    spatial_hash m_spatial_hash;
+    std::vector<float> m_densities;
+
+    float m_fixed_timestep = 0.0f;
+    float m_time_accumulator = 0.0f;
+    // NOTE: position of the drawn state between the previous (0) and the current (1) simulation steps
+    float m_interpolation_factor = 1.0f;
+
+    glm::vec3 m_camera_position = glm::vec3(0.0f);
+    float m_lod_start_distance2 = 0.0f;
+    float m_lod_min_density = 1.0f;
+
+    // NOTE: budget state, see particle_budget. Requested emit count includes particles dropped by the limit
+    size_t m_budget_live_limit = std::numeric_limits<size_t>::max();
+    float m_budget_density = 1.0f;
+    size_t m_requested_emit_count = 0;
+    size_t m_visible_count = 0;
+    glm::vec3 m_last_emit_position = glm::vec3(0.0f);
+
+    bool m_gpu_frustum_culling = false;
+    frustum m_gpu_frustum;
 
-    size_t m_pool_index;
     size_t active_particles_count = 0;
-};
\ No newline at end of file
+};
+
+
+// Continuous particle source. Spawns rate particles per second independently of the frame rate,
+// spawn times are spread over the frame so that particles don't come out in clumps
+class particle_emitter {
+public:
+    particle_emitter() = default;
+    particle_emitter(const particle_props& props, float rate);
+
+    void update(float dt, particle_system& system) noexcept;
+
+public:
+    particle_props props;
+    float rate = 0.0f;
+
+private:
+    float m_accumulator = 0.0f;
+};
@@ -0,0 +1,53 @@
+#include "radix_sort.hpp"
+
+#include <array>
+
+void radix_sort(std::vector<sort_entry> &entries, std::vector<sort_entry> &temp) noexcept {
+    constexpr size_t RADIX_BITS = 8;
+    constexpr size_t RADIX_SIZE = 1 << RADIX_BITS;
+    constexpr size_t PASS_COUNT = sizeof(uint32_t) * 8 / RADIX_BITS;
+
+    const size_t count = entries.size();
+    if (count < 2) {
+        return;
+    }
+
+    std::array<std::array<uint32_t, RADIX_SIZE>, PASS_COUNT> histograms = {};
+    for (size_t i = 0; i < count; ++i) {
+        const uint32_t key = entries[i].key;
+        for (size_t pass = 0; pass < PASS_COUNT; ++pass) {
+            ++histograms[pass][(key >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1)];
+        }
+    }
+
+    temp.resize(count);
+
+    sort_entry* src = entries.data();
+    sort_entry* dst = temp.data();
+    for (size_t pass = 0; pass < PASS_COUNT; ++pass) {
+        std::array<uint32_t, RADIX_SIZE>& histogram = histograms[pass];
+
+        const uint32_t first_digit = (src[0].key >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1);
+        if (histogram[first_digit] == count) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (size_t digit = 0; digit < RADIX_SIZE; ++digit) {
+            const uint32_t digit_count = histogram[digit];
+            histogram[digit] = offset;
+            offset += digit_count;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            const uint32_t digit = (src[i].key >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1);
+            dst[histogram[digit]++] = src[i];
+        }
+
+        std::swap(src, dst);
+    }
+
+    if (src != entries.data()) {
+        entries.swap(temp);
+    }
+}
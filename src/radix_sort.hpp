@@ -0,0 +1,20 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+struct sort_entry {
+    uint32_t key;
+    uint32_t index;
+};
+
+// Maps a float onto an unsigned key that keeps the float ordering (negative values included)
+inline uint32_t float_to_sort_key(float value) noexcept {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    
+    return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+
+// Stable LSD radix sort by sort_entry::key in ascending order. temp is used as a scratch buffer
+void radix_sort(std::vector<sort_entry>& entries, std::vector<sort_entry>& temp) noexcept;
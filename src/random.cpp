@@ -0,0 +1,209 @@
+#include "random.hpp"
+#include "simd.hpp"
+
+#include <atomic>
+#include <limits>
+#include <chrono>
+#include <random>
+
+namespace {
+    uint64_t splitmix64(uint64_t& state) noexcept {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    uint64_t default_seed() noexcept {
+        std::random_device rd;
+        return (static_cast<uint64_t>(rd()) << 32) ^ rd() ^ static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    }
+
+    std::atomic<uint64_t> global_seed = default_seed();
+    std::atomic<uint32_t> seed_epoch = 0;
+    std::atomic<uint64_t> thread_counter = 0;
+
+    struct thread_random_state {
+        random_generator generator = random_generator(0);
+        uint64_t thread_index = thread_counter.fetch_add(1);
+        uint32_t epoch = ~0u;
+    };
+
+    thread_local thread_random_state thread_state;
+}
+
+random_generator::random_generator() 
+    : random_generator(default_seed())
+{
+}
+
+random_generator::random_generator(uint64_t seed) {
+    this->seed(seed);
+}
+
+void random_generator::seed(uint64_t seed) noexcept {
+    // NOTE: splitmix64 spreads even poor seeds like 0 or 1 over the whole state, the state must not be all zeros
+    for (size_t i = 0; i < 4; i += 2) {
+        const uint64_t value = splitmix64(seed);
+        m_state[i] = static_cast<uint32_t>(value);
+        m_state[i + 1] = static_cast<uint32_t>(value >> 32);
+    }
+
+    for (size_t word = 0; word < 4; ++word) {
+        for (size_t lane = 0; lane < 4; lane += 2) {
+            const uint64_t value = splitmix64(seed);
+            m_batch_state[word][lane] = static_cast<uint32_t>(value);
+            m_batch_state[word][lane + 1] = static_cast<uint32_t>(value >> 32);
+        }
+    }
+}
+
+uint32_t random_generator::uniform(uint32_t min, uint32_t max) noexcept {
+    if (min >= max) {
+        return min;
+    }
+
+    const uint64_t range = static_cast<uint64_t>(max - min) + 1;
+    if (range > std::numeric_limits<uint32_t>::max()) {
+        return next_u32();
+    }
+
+    // NOTE: Lemire's multiply-shift reduction with rejection of the biased part
+    uint64_t product = static_cast<uint64_t>(next_u32()) * range;
+    uint32_t low = static_cast<uint32_t>(product);
+    if (low < range) {
+        const uint32_t threshold = static_cast<uint32_t>((0x100000000ull - range) % range);
+        while (low < threshold) {
+            product = static_cast<uint64_t>(next_u32()) * range;
+            low = static_cast<uint32_t>(product);
+        }
+    }
+
+    return min + static_cast<uint32_t>(product >> 32);
+}
+
+int32_t random_generator::uniform(int32_t min, int32_t max) noexcept {
+    if (min >= max) {
+        return min;
+    }
+
+    const uint32_t offset = uniform(0u, static_cast<uint32_t>(static_cast<int64_t>(max) - min));
+    return static_cast<int32_t>(static_cast<int64_t>(min) + offset);
+}
+
+uint64_t random_generator::uniform(uint64_t min, uint64_t max) noexcept {
+    if (min >= max) {
+        return min;
+    }
+
+    const uint64_t range = max - min;
+    if (range <= std::numeric_limits<uint32_t>::max()) {
+        return min + uniform(0u, static_cast<uint32_t>(range));
+    }
+
+    // NOTE: draws are masked to the smallest power of 2 covering the range and the ones out of it are rejected,
+    // less than half of them on average. Multiply-shift reduction would need a 128-bit product
+    uint64_t mask = range;
+    mask |= mask >> 1;
+    mask |= mask >> 2;
+    mask |= mask >> 4;
+    mask |= mask >> 8;
+    mask |= mask >> 16;
+    mask |= mask >> 32;
+
+    uint64_t value = next_u64() & mask;
+    while (value > range) {
+        value = next_u64() & mask;
+    }
+
+    return min + value;
+}
+
+int64_t random_generator::uniform(int64_t min, int64_t max) noexcept {
+    if (min >= max) {
+        return min;
+    }
+
+    const uint64_t offset = uniform(uint64_t(0), static_cast<uint64_t>(max) - static_cast<uint64_t>(min));
+    return static_cast<int64_t>(static_cast<uint64_t>(min) + offset);
+}
+
+void random_generator::fill(float* values, size_t count, float min, float max) noexcept {
+    const float scale = max - min;
+    size_t i = 0;
+
+#ifdef SIMD_SSE2
+    __m128i s0 = _mm_load_si128(reinterpret_cast<const __m128i*>(m_batch_state[0]));
+    __m128i s1 = _mm_load_si128(reinterpret_cast<const __m128i*>(m_batch_state[1]));
+    __m128i s2 = _mm_load_si128(reinterpret_cast<const __m128i*>(m_batch_state[2]));
+    __m128i s3 = _mm_load_si128(reinterpret_cast<const __m128i*>(m_batch_state[3]));
+
+    const __m128i one_exponent = _mm_set1_epi32(0x3F800000);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 min_v = _mm_set1_ps(min);
+    const __m128 scale_v = _mm_set1_ps(scale);
+
+    for (; i + 4 <= count; i += 4) {
+        const __m128i result = _mm_add_epi32(s0, s3);
+        const __m128i t = _mm_slli_epi32(s1, 9);
+
+        s2 = _mm_xor_si128(s2, s0);
+        s3 = _mm_xor_si128(s3, s1);
+        s1 = _mm_xor_si128(s1, s2);
+        s0 = _mm_xor_si128(s0, s3);
+        s2 = _mm_xor_si128(s2, t);
+        s3 = _mm_or_si128(_mm_slli_epi32(s3, 11), _mm_srli_epi32(s3, 21));
+
+        // NOTE: upper 23 bits as mantissa of a float in [1, 2)
+        const __m128 unit = _mm_sub_ps(_mm_castsi128_ps(_mm_or_si128(_mm_srli_epi32(result, 9), one_exponent)), one);
+        _mm_storeu_ps(values + i, _mm_add_ps(min_v, _mm_mul_ps(unit, scale_v)));
+    }
+
+    _mm_store_si128(reinterpret_cast<__m128i*>(m_batch_state[0]), s0);
+    _mm_store_si128(reinterpret_cast<__m128i*>(m_batch_state[1]), s1);
+    _mm_store_si128(reinterpret_cast<__m128i*>(m_batch_state[2]), s2);
+    _mm_store_si128(reinterpret_cast<__m128i*>(m_batch_state[3]), s3);
+#endif
+
+    for (; i < count; ++i) {
+        values[i] = min + scale * next_float();
+    }
+}
+
+void random_generator::fill(glm::vec3* values, size_t count, const glm::vec3& min, const glm::vec3& max) noexcept {
+    static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "glm::vec3 must be tightly packed");
+
+    float* components = &values[0].x;
+    fill(components, count * 3, 0.0f, 1.0f);
+
+    const glm::vec3 scale = max - min;
+    for (size_t i = 0; i < count; ++i) {
+        values[i] = min + scale * values[i];
+    }
+}
+
+void random_generator::fill(uint32_t* values, size_t count) noexcept {
+    for (size_t i = 0; i < count; ++i) {
+        values[i] = next_u32();
+    }
+}
+
+random_generator& thread_random() noexcept {
+    thread_random_state& state = thread_state;
+
+    const uint32_t epoch = seed_epoch.load(std::memory_order_acquire);
+    if (state.epoch != epoch) {
+        uint64_t seed = global_seed.load(std::memory_order_relaxed) ^ (state.thread_index * 0xD1B54A32D192ED03ull);
+        state.generator.seed(splitmix64(seed));
+        state.epoch = epoch;
+    }
+
+    return state.generator;
+}
+
+void set_random_seed(uint64_t seed) noexcept {
+    global_seed.store(seed, std::memory_order_relaxed);
+    seed_epoch.fetch_add(1, std::memory_order_release);
+
+    thread_random();
+}
@@ -1,15 +1,112 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
 
-#include <random>
+#include <glm/glm.hpp>
 
+// xoshiro128+ generator (Blackman, Vigna). Not thread safe, use thread_random() to get the generator of the calling thread.
+// Batch fill() runs 4 independent streams at once with SSE2
+class random_generator {
+public:
+    random_generator();
+    random_generator(uint64_t seed);
+
+    void seed(uint64_t seed) noexcept;
+
+    uint32_t next_u32() noexcept;
+    // Two draws, the first one is the high half
+    uint64_t next_u64() noexcept;
+    // Uniform in [0, 1)
+    float next_float() noexcept;
+    double next_double() noexcept;
+
+    float uniform(float min, float max) noexcept;
+    double uniform(double min, double max) noexcept;
+    // Uniform in [min, max]
+    uint32_t uniform(uint32_t min, uint32_t max) noexcept;
+    int32_t uniform(int32_t min, int32_t max) noexcept;
+    uint64_t uniform(uint64_t min, uint64_t max) noexcept;
+    int64_t uniform(int64_t min, int64_t max) noexcept;
+
+    void fill(float* values, size_t count, float min, float max) noexcept;
+    void fill(glm::vec3* values, size_t count, const glm::vec3& min, const glm::vec3& max) noexcept;
+    void fill(uint32_t* values, size_t count) noexcept;
+
+private:
+    static uint32_t _rotl(uint32_t value, int32_t shift) noexcept;
+
+private:
+    uint32_t m_state[4];
+    // NOTE: state of 4 streams used by batch fill, lane-interleaved so it can be loaded into SSE registers directly
+    alignas(16) uint32_t m_batch_state[4][4];
+};
+
+// Generator of the calling thread. Generators are created lazily and seeded from the global seed and the thread creation order
+random_generator& thread_random() noexcept;
+
+// Reseeds generators of all threads for reproducible runs. Generator of the calling thread is reseeded immediately,
+// the others on their next thread_random() call. Results of worker threads are reproducible only if work is distributed the same way
+void set_random_seed(uint64_t seed) noexcept;
+
+
+// NOTE: types wider than 32 bits are drawn with 64-bit (double) precision, narrower ones with 32-bit (float) precision
 template <typename Type, typename = std::enable_if_t<std::is_arithmetic_v<Type>>>
-inline Type random(Type min, Type max) noexcept {       
-    static std::random_device _rd;
-    static std::mt19937 gen(_rd());
-    
+inline Type random(Type min, Type max) noexcept {
     if constexpr (std::is_floating_point_v<Type>) {
-        return std::uniform_real_distribution<Type>(min, max)(gen);
+        using draw_type = std::conditional_t<(sizeof(Type) > sizeof(float)), double, float>;
+        return static_cast<Type>(thread_random().uniform(static_cast<draw_type>(min), static_cast<draw_type>(max)));
+    } else if constexpr (std::is_signed_v<Type>) {
+        using draw_type = std::conditional_t<(sizeof(Type) > sizeof(int32_t)), int64_t, int32_t>;
+        return static_cast<Type>(thread_random().uniform(static_cast<draw_type>(min), static_cast<draw_type>(max)));
     } else {
-        return std::uniform_int_distribution<Type>(min, max)(gen);
+        using draw_type = std::conditional_t<(sizeof(Type) > sizeof(uint32_t)), uint64_t, uint32_t>;
+        return static_cast<Type>(thread_random().uniform(static_cast<draw_type>(min), static_cast<draw_type>(max)));
     }
-}
\ No newline at end of file
+}
+
+inline void random_fill(float* values, size_t count, float min, float max) noexcept {
+    thread_random().fill(values, count, min, max);
+}
+
+
+inline uint32_t random_generator::_rotl(uint32_t value, int32_t shift) noexcept {
+    return (value << shift) | (value >> (32 - shift));
+}
+
+inline uint32_t random_generator::next_u32() noexcept {
+    const uint32_t result = m_state[0] + m_state[3];
+    const uint32_t t = m_state[1] << 9;
+
+    m_state[2] ^= m_state[0];
+    m_state[3] ^= m_state[1];
+    m_state[1] ^= m_state[2];
+    m_state[0] ^= m_state[3];
+    m_state[2] ^= t;
+    m_state[3] = _rotl(m_state[3], 11);
+
+    return result;
+}
+
+inline float random_generator::next_float() noexcept {
+    // NOTE: upper bits of xoshiro128+ are the best ones, 24 of them fill float mantissa exactly
+    return static_cast<float>(next_u32() >> 8) * (1.0f / 16777216.0f);
+}
+
+inline uint64_t random_generator::next_u64() noexcept {
+    const uint64_t high = next_u32();
+    return (high << 32) | next_u32();
+}
+
+inline double random_generator::next_double() noexcept {
+    // NOTE: 53 upper bits fill double mantissa exactly
+    return static_cast<double>(next_u64() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+inline float random_generator::uniform(float min, float max) noexcept {
+    return min + (max - min) * next_float();
+}
+
+inline double random_generator::uniform(double min, double max) noexcept {
+    return min + (max - min) * next_double();
+}
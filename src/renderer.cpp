@@ -71,7 +71,144 @@ void renderer::render(uint32_t mode, const shader &shader, const model &model) c
 
 void renderer::render(uint32_t mode, const shader &shader, const particle_system &particles) const noexcept {
     particles.bind_buffers();
-    render_instanced(GL_TRIANGLES, shader, particles.m_mesh, particles.active_particles_count);
+    shader.uniform("u_atlas_sizes[" + std::to_string(particles.m_atlas_layer) + "]", particles.m_atlas_dimension);
+
+    if (particles.m_backend == particle_system::backend::GPU) {
+        render_instanced_indirect(mode, shader, particles.m_mesh, particles.m_draw_command_buffer);
+    } else {
+        render_instanced(mode, shader, particles.m_mesh, particles.active_particles_count);
+        particles.m_instances_ring.lock_region();
+    }
+}
+
+void renderer::render(uint32_t mode, const shader &shader, const particle_batch &batch) const noexcept {
+    if (batch.m_instance_count == 0) {
+        return;
+    }
+
+    batch.bind_buffers();
+
+    if (batch.m_atlas != nullptr) {
+        shader.uniform("u_atlas", *batch.m_atlas, 0);
+        for (uint32_t layer = 0; layer < batch.m_atlas->get_layer_count(); ++layer) {
+            shader.uniform("u_layer_uv_scales[" + std::to_string(layer) + "]", batch.m_atlas->get_layer_uv_scale(layer));
+        }
+    }
+
+    for (const particle_system* system : batch.m_systems) {
+        shader.uniform("u_atlas_sizes[" + std::to_string(system->m_atlas_layer) + "]", system->m_atlas_dimension);
+    }
+
+    // NOTE: all systems share the same quad
+    render_instanced(mode, shader, batch.m_systems.front()->m_mesh, batch.m_instance_count);
+    batch.m_instances_ring.lock_region();
+}
+
+void renderer::render(const shader &shader, const terrain &terrain, const terrain_selection &selection) const noexcept {
+    if (selection.m_patches.empty()) {
+        return;
+    }
+
+    selection.m_patches_ring.bind_range(0);
+
+    shader.uniform("u_height_map", terrain.height_texture, terrain::HEIGHT_MAP_UNIT);
+    shader.uniform("u_normal_map", terrain.normal_texture, terrain::NORMAL_MAP_UNIT);
+    shader.uniform("u_terrain_size", glm::vec2(terrain.width, terrain.depth));
+    shader.uniform("u_height_range", terrain.height_texture_range);
+    shader.uniform("u_dudv", terrain.dudv);
+    shader.uniform("u_water_height", terrain.water_height);
+    shader.uniform("u_per_vertex_normals", false);
+    shader.uniform("u_camera_localspace", selection.m_camera_position);
+    for (size_t lod = 0; lod < selection.m_morph_ranges.size(); ++lod) {
+        shader.uniform("u_morph_ranges[" + std::to_string(lod) + "]", selection.m_morph_ranges[lod]);
+    }
+
+    shader.bind();
+    terrain.grid_vao.bind();
+
+    // NOTE: fixed restart index is the largest value of the index type, 0xFFFF for 16-bit indices
+    OGL_CALL(glEnable(GL_PRIMITIVE_RESTART_FIXED_INDEX));
+    OGL_CALL(glDrawElementsInstanced(GL_TRIANGLE_STRIP, terrain.grid_ibo.get_element_count(), GL_UNSIGNED_SHORT, nullptr, selection.m_patches.size()));
+    OGL_CALL(glDisable(GL_PRIMITIVE_RESTART_FIXED_INDEX));
+
+    selection.m_patches_ring.lock_region();
+}
+
+void renderer::render(const shader &shader, const terrain_streamer &terrain, const terrain_selection &selection) const noexcept {
+    if (selection.m_patches.empty()) {
+        return;
+    }
+
+    selection.m_patches_ring.bind_range(0);
+
+    const terrain_pyramid::header& header = terrain.get_header();
+
+    shader.uniform("u_tiles", terrain.m_tiles_texture, terrain::HEIGHT_MAP_UNIT);
+    shader.uniform("u_terrain_size", glm::vec2(header.width, header.depth));
+    shader.uniform("u_height_range", glm::vec2(header.min_height, header.max_height));
+    shader.uniform("u_dudv", terrain.m_dudv);
+    shader.uniform("u_per_vertex_normals", true);
+    shader.uniform("u_camera_localspace", selection.m_camera_position);
+    for (size_t lod = 0; lod < selection.m_morph_ranges.size(); ++lod) {
+        shader.uniform("u_morph_ranges[" + std::to_string(lod) + "]", selection.m_morph_ranges[lod]);
+    }
+
+    shader.bind();
+    terrain.m_grid_vao.bind();
+
+    OGL_CALL(glEnable(GL_PRIMITIVE_RESTART_FIXED_INDEX));
+    OGL_CALL(glDrawElementsInstanced(GL_TRIANGLE_STRIP, terrain.m_grid_ibo.get_element_count(), GL_UNSIGNED_SHORT, nullptr, selection.m_patches.size()));
+    OGL_CALL(glDisable(GL_PRIMITIVE_RESTART_FIXED_INDEX));
+
+    selection.m_patches_ring.lock_region();
+}
+
+void renderer::render(const shader &shader, const terrain_clipmap &clipmap, const terrain_selection &selection) const noexcept {
+    if (selection.m_patches.empty()) {
+        return;
+    }
+
+    selection.m_patches_ring.bind_range(0);
+
+    const terrain& source = *clipmap.m_source;
+
+    shader.uniform("u_clipmap", clipmap.m_clipmap_texture, terrain::HEIGHT_MAP_UNIT);
+    shader.uniform("u_clipmap_size", static_cast<float>(clipmap.m_size));
+    shader.uniform("u_morph_width", clipmap.m_size * terrain_clipmap::MORPH_WIDTH_RATIO);
+    for (size_t level = 0; level < clipmap.m_level_origins.size(); ++level) {
+        shader.uniform("u_level_origins[" + std::to_string(level) + "]", glm::vec2(clipmap.m_level_origins[level]));
+    }
+    shader.uniform("u_terrain_size", glm::vec2(source.width, source.depth));
+    shader.uniform("u_height_range", glm::vec2(source.min_height, source.max_height));
+    shader.uniform("u_dudv", source.dudv);
+    shader.uniform("u_per_vertex_normals", true);
+
+    shader.bind();
+    clipmap.m_pieces_vao.bind();
+
+    OGL_CALL(glEnable(GL_PRIMITIVE_RESTART_FIXED_INDEX));
+
+    // NOTE: patches are grouped by piece type, base instance points the group patches in the buffer
+    for (size_t first = 0; first < selection.m_patches.size();) {
+        const int32_t type = static_cast<int32_t>(selection.m_patches[first].w) / terrain::MAX_LOD_COUNT;
+
+        size_t last = first + 1;
+        while (last < selection.m_patches.size() && static_cast<int32_t>(selection.m_patches[last].w) / terrain::MAX_LOD_COUNT == type) {
+            ++last;
+        }
+
+        const terrain_clipmap::piece_mesh& mesh = clipmap.m_piece_meshes[type];
+        shader.uniform("u_grid_width", mesh.quads_x + 1);
+
+        OGL_CALL(glDrawElementsInstancedBaseInstance(GL_TRIANGLE_STRIP, mesh.index_count, GL_UNSIGNED_SHORT, 
+            reinterpret_cast<const void*>(mesh.first_index * sizeof(uint16_t)), last - first, first));
+
+        first = last;
+    }
+
+    OGL_CALL(glDisable(GL_PRIMITIVE_RESTART_FIXED_INDEX));
+
+    selection.m_patches_ring.lock_region();
 }
 
 void renderer::render_instanced(uint32_t mode, const shader &shader, const mesh &mesh, size_t count) const noexcept {
@@ -96,3 +233,13 @@ void renderer::render_instanced(uint32_t mode, const shader &shader, const model
         render_instanced(mode, shader, meshes->at(i), count);
     }
 }
+
+
+void renderer::render_instanced_indirect(uint32_t mode, const shader &shader, const mesh &mesh, const buffer &command_buffer) const noexcept {
+    ASSERT(mesh.ibo.get_element_count() > 0, "renderer", "indirect rendering is supported for indexed meshes only");
+
+    mesh.bind(shader);
+    command_buffer.bind();
+
+    OGL_CALL(glDrawElementsIndirect(mode, GL_UNSIGNED_INT, nullptr));
+}
\ No newline at end of file
@@ -1,7 +1,10 @@
 #pragma once
 #include "shader.hpp"
 #include "model.hpp"
-#include "particle_system.hpp"
+#include "particle_batch.hpp"
+#include "terrain.hpp"
+#include "terrain_streamer.hpp"
+#include "terrain_clipmap.hpp"
 
 class renderer {
 public:
@@ -24,6 +27,15 @@ public:
     void render(uint32_t mode, const shader& shader, const mesh& mesh) const noexcept;
     void render(uint32_t mode, const shader& shader, const model& model) const noexcept;
     void render(uint32_t mode, const shader& shader, const particle_system& particles) const noexcept;
+    void render(uint32_t mode, const shader& shader, const particle_batch& batch) const noexcept;
+    // Draws patches of the selection as instanced triangle strips, selection must be uploaded. 
+    // Ground and water selections share the same grid, they differ by shader only
+    void render(const shader& shader, const terrain& terrain, const terrain_selection& selection) const noexcept;
+    // Same for the selection of the streamed terrain, drawn by terrain_streamed vertex shaders
+    void render(const shader& shader, const terrain_streamer& terrain, const terrain_selection& selection) const noexcept;
+    // Draws pieces of the clipmap selection by terrain_clipmap vertex shaders, one instanced draw per piece type
+    void render(const shader& shader, const terrain_clipmap& clipmap, const terrain_selection& selection) const noexcept;
     void render_instanced(uint32_t mode, const shader& shader, const mesh& mesh, size_t count) const noexcept;
     void render_instanced(uint32_t mode, const shader& shader, const model& model, size_t count) const noexcept;
+    void render_instanced_indirect(uint32_t mode, const shader& shader, const mesh& mesh, const buffer& command_buffer) const noexcept;
 };
\ No newline at end of file
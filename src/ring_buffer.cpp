@@ -0,0 +1,102 @@
+#include "ring_buffer.hpp"
+
+#include "debug.hpp"
+
+ring_buffer::ring_buffer(int32_t target, size_t region_size, size_t element_size) {
+    create(target, region_size, element_size);
+}
+
+ring_buffer::~ring_buffer() {
+    destroy();
+}
+
+void ring_buffer::create(int32_t target, size_t region_size, size_t element_size) noexcept {
+    if (m_buffer.id != 0) {
+        LOG_WARN("ring buffer", "ring buffer recreation (prev id = " + std::to_string(m_buffer.id) + ")");
+        destroy();
+    }
+
+    int32_t offset_alignment = 1;
+    if (target == GL_SHADER_STORAGE_BUFFER) {
+        OGL_CALL(glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &offset_alignment));
+    } else if (target == GL_UNIFORM_BUFFER) {
+        OGL_CALL(glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offset_alignment));
+    }
+
+    m_region_size = region_size;
+    m_region_stride = (region_size + offset_alignment - 1) / offset_alignment * offset_alignment;
+    m_region = 0;
+
+    const uint32_t flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    m_buffer.create_storage(target, m_region_stride * REGION_COUNT, element_size, flags, nullptr);
+
+    m_mapped_data = static_cast<uint8_t*>(m_buffer.map_range(0, m_buffer.size, flags));
+    ASSERT(m_mapped_data != nullptr, "ring buffer", "failed to map buffer persistently");
+}
+
+void ring_buffer::destroy() noexcept {
+    for (GLsync& fence : m_fences) {
+        if (fence != nullptr) {
+            OGL_CALL(glDeleteSync(fence));
+            fence = nullptr;
+        }
+    }
+
+    if (m_mapped_data != nullptr) {
+        m_buffer.unmap();
+        m_mapped_data = nullptr;
+    }
+
+    m_buffer.destroy();
+}
+
+void* ring_buffer::next_region() noexcept {
+    m_region = (m_region + 1) % REGION_COUNT;
+    _wait_region(m_region);
+
+    return m_mapped_data + get_region_offset();
+}
+
+void ring_buffer::lock_region() const noexcept {
+    GLsync& fence = m_fences[m_region];
+    if (fence != nullptr) {
+        OGL_CALL(glDeleteSync(fence));
+    }
+
+    OGL_CALL(fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+}
+
+void ring_buffer::bind_range(size_t index) const noexcept {
+    m_buffer.bind_range(index, get_region_offset(), m_region_size);
+}
+
+size_t ring_buffer::get_region_size() const noexcept {
+    return m_region_size;
+}
+
+size_t ring_buffer::get_region_offset() const noexcept {
+    return m_region * m_region_stride;
+}
+
+void ring_buffer::_wait_region(size_t region) noexcept {
+    GLsync& fence = m_fences[region];
+    if (fence == nullptr) {
+        return;
+    }
+
+    uint32_t wait_flags = 0;
+    while (true) {
+        uint32_t status;
+        OGL_CALL(status = glClientWaitSync(fence, wait_flags, 1'000'000));
+        
+        if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED || status == GL_WAIT_FAILED) {
+            ASSERT(status != GL_WAIT_FAILED, "ring buffer", "glClientWaitSync failed");
+            break;
+        }
+
+        wait_flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    }
+
+    OGL_CALL(glDeleteSync(fence));
+    fence = nullptr;
+}
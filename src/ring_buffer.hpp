@@ -0,0 +1,46 @@
+#pragma once
+#include <glad/glad.h>
+
+#include <array>
+
+#include "buffer.hpp"
+
+#include "nocopyable.hpp"
+
+// Persistently mapped buffer split into REGION_COUNT regions. Each frame the next region is written by CPU
+// while GPU may still read the previous ones, regions are guarded by fences instead of implicit map/unmap synchronization
+class ring_buffer : public nocopyable {
+public:
+    static constexpr size_t REGION_COUNT = 3;
+
+public:
+    ring_buffer() = default;
+    ring_buffer(int32_t target, size_t region_size, size_t element_size);
+    ~ring_buffer();
+
+    void create(int32_t target, size_t region_size, size_t element_size) noexcept;
+    void destroy() noexcept;
+
+    // Switches to the next region, waits until GPU has finished reading it and returns its mapped memory
+    void* next_region() noexcept;
+    // Must be called after the commands which read the current region have been issued
+    void lock_region() const noexcept;
+
+    void bind_range(size_t index) const noexcept;
+
+    size_t get_region_size() const noexcept;
+    size_t get_region_offset() const noexcept;
+
+private:
+    void _wait_region(size_t region) noexcept;
+
+private:
+    buffer m_buffer;
+    mutable std::array<GLsync, REGION_COUNT> m_fences = {};
+
+    uint8_t* m_mapped_data = nullptr;
+
+    size_t m_region_size = 0;
+    size_t m_region_stride = 0;
+    size_t m_region = 0;
+};
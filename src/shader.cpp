@@ -9,6 +9,10 @@ shader::shader(const std::string& vs_filepath, const std::string& fs_filepath, c
     create(vs_filepath, fs_filepath, gs_filepath);
 }
 
+shader::shader(const std::string& cs_filepath) {
+    create(cs_filepath);
+}
+
 shader::~shader() {
     destroy();
 }
@@ -20,26 +24,24 @@ void shader::create(const std::string& vs_filepath, const std::string& fs_filepa
 
     m_program_id = _create_shader_program(vs_id, fs_id, gs_id);
 
-#ifdef _DEBUG
-    OGL_CALL(glValidateProgram(m_program_id));
-    
-    int32_t link_status;
-    OGL_CALL(glGetProgramiv(m_program_id, GL_LINK_STATUS, &link_status));
-    if (link_status == GL_FALSE) {
-        int32_t log_len = 0;
-        OGL_CALL(glGetProgramiv(m_program_id, GL_INFO_LOG_LENGTH, &log_len));
+    _check_link_status(m_program_id);
+}
 
-        char* shader_error_log = (char*)alloca(log_len);
-        OGL_CALL(glGetProgramInfoLog(m_program_id, log_len, nullptr, shader_error_log));
-        OGL_CALL(glDeleteProgram(m_program_id));
-        
-        ASSERT(false, "shader program linking error", shader_error_log);
-    }
-#endif
+void shader::create(const std::string& cs_filepath) noexcept {
+    const uint32_t cs_id = _create_shader(GL_COMPUTE_SHADER, cs_filepath);
+
+    m_program_id = _create_shader_program(cs_id);
+
+    _check_link_status(m_program_id);
 }
 
 void shader::destroy() noexcept {
+    if (m_program_id == 0) {
+        return;
+    }
+
     OGL_CALL(glDeleteProgram(m_program_id));
+    m_program_id = 0;
 }
 
 std::string shader::_read_shader_data_from_file(const std::string& filepath) noexcept {
@@ -93,6 +95,25 @@ uint32_t shader::_create_shader(GLenum shader_type, const std::string& filepath)
     return id;
 }
 
+void shader::_check_link_status(uint32_t program_id) noexcept {
+#ifdef _DEBUG
+    OGL_CALL(glValidateProgram(program_id));
+    
+    int32_t link_status;
+    OGL_CALL(glGetProgramiv(program_id, GL_LINK_STATUS, &link_status));
+    if (link_status == GL_FALSE) {
+        int32_t log_len = 0;
+        OGL_CALL(glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &log_len));
+
+        char* shader_error_log = (char*)alloca(log_len);
+        OGL_CALL(glGetProgramInfoLog(program_id, log_len, nullptr, shader_error_log));
+        OGL_CALL(glDeleteProgram(program_id));
+        
+        ASSERT(false, "shader program linking error", shader_error_log);
+    }
+#endif
+}
+
 uint32_t shader::get_id() const noexcept {
     return m_program_id;
 }
@@ -150,6 +171,11 @@ void shader::uniform(const std::string &name, const texture_2d &texture, int32_t
     texture.bind(unit);
 }
 
+void shader::uniform(const std::string &name, const texture_2d_array &array, int32_t unit) const noexcept {
+    this->uniform(name, unit);
+    array.bind(unit);
+}
+
 void shader::uniform(const std::string &name, const cubemap &cubemap, int32_t unit) const noexcept {
     this->uniform(name, unit);
     cubemap.bind(unit);
@@ -12,6 +12,7 @@
 #include <optional>
 
 #include "texture.hpp"
+#include "texture_2d_array.hpp"
 #include "cubemap.hpp"
 
 #include "nocopyable.hpp"
@@ -20,10 +21,12 @@ class shader : public nocopyable {
 public:
     shader() = default;
     shader(const std::string& vs_filepath, const std::string& fs_filepath, const std::optional<std::string>& gs_filepath = std::nullopt);
+    shader(const std::string& cs_filepath);
 
     ~shader();
 
     void create(const std::string& vs_filepath, const std::string& fs_filepath, const std::optional<std::string>& gs_filepath = std::nullopt) noexcept;
+    void create(const std::string& cs_filepath) noexcept;
     void destroy() noexcept;
     uint32_t get_id() const noexcept;
 
@@ -41,6 +44,7 @@ public:
     void uniform(const std::string& name, const glm::mat3& uniform) const noexcept;
     void uniform(const std::string& name, const glm::mat4& uniform) const noexcept;
     void uniform(const std::string& name, const texture_2d& texture, int32_t unit) const noexcept;
+    void uniform(const std::string& name, const texture_2d_array& array, int32_t unit) const noexcept;
     void uniform(const std::string& name, const cubemap& cubemap, int32_t unit) const noexcept;
 
     shader(shader&& shader);
@@ -57,6 +61,7 @@ private:
     static std::string _read_shader_data_from_file(const std::string& filepath) noexcept;
     static uint32_t _compile_shader(GLenum shader_type, const std::string& source) noexcept;
     static uint32_t _create_shader(GLenum shader_type, const std::string& filepath) noexcept;
+    static void _check_link_status(uint32_t program_id) noexcept;
 
     template <typename ID, typename... IDs>
     static void _attach_shader(uint32_t program_id, ID first, IDs&&... args) noexcept;
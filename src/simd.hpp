@@ -0,0 +1,136 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+
+// SIMD_AVX - 8 floats per register, SIMD_SSE2 - 128-bit registers are available (with AVX too).
+// simd::type is the widest float register, kernels process WIDTH values per iteration and the rest by scalar tails.
+// simd::itype holds WIDTH 32-bit integers with wrapping arithmetic, it's used for hashing and indexing
+#if defined(__AVX__)
+    #include <immintrin.h>
+    #define SIMD_AVX
+    #define SIMD_SSE2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #if defined(__SSE4_1__)
+        #include <smmintrin.h>
+    #endif
+    #define SIMD_SSE2
+#endif
+
+namespace simd {
+#if defined(SIMD_AVX)
+    using type = __m256;
+    constexpr size_t WIDTH = 8;
+
+    inline type load(const float* ptr) noexcept { return _mm256_loadu_ps(ptr); }
+    inline void store(float* ptr, type value) noexcept { _mm256_storeu_ps(ptr, value); }
+    inline type set(float value) noexcept { return _mm256_set1_ps(value); }
+    inline type add(type a, type b) noexcept { return _mm256_add_ps(a, b); }
+    inline type sub(type a, type b) noexcept { return _mm256_sub_ps(a, b); }
+    inline type mul(type a, type b) noexcept { return _mm256_mul_ps(a, b); }
+    inline type div(type a, type b) noexcept { return _mm256_div_ps(a, b); }
+    inline type min(type a, type b) noexcept { return _mm256_min_ps(a, b); }
+    inline type max(type a, type b) noexcept { return _mm256_max_ps(a, b); }
+    inline type sqrt(type a) noexcept { return _mm256_sqrt_ps(a); }
+    inline type floor(type a) noexcept { return _mm256_floor_ps(a); }
+
+    using itype = __m256i;
+
+    // NOTE: truncates towards zero
+    inline itype to_int(type a) noexcept { return _mm256_cvttps_epi32(a); }
+    inline type to_float(itype a) noexcept { return _mm256_cvtepi32_ps(a); }
+    inline itype iset(uint32_t value) noexcept { return _mm256_set1_epi32(static_cast<int32_t>(value)); }
+    inline void istore(int32_t* ptr, itype value) noexcept { _mm256_storeu_si256(reinterpret_cast<__m256i*>(ptr), value); }
+    inline itype ixor(itype a, itype b) noexcept { return _mm256_castps_si256(_mm256_xor_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b))); }
+    #if defined(__AVX2__)
+    inline itype iadd(itype a, itype b) noexcept { return _mm256_add_epi32(a, b); }
+    inline itype imul(itype a, itype b) noexcept { return _mm256_mullo_epi32(a, b); }
+    template <int N> inline itype shift_right(itype a) noexcept { return _mm256_srli_epi32(a, N); }
+    #else
+    namespace detail {
+        // NOTE: AVX has no 256-bit integer arithmetic, halves are processed by SSE instructions
+        template <typename Func>
+        inline itype per_half(itype a, itype b, const Func& func) noexcept {
+            const __m128i low = func(_mm256_castsi256_si128(a), _mm256_castsi256_si128(b));
+            const __m128i high = func(_mm256_extractf128_si256(a, 1), _mm256_extractf128_si256(b, 1));
+            return _mm256_insertf128_si256(_mm256_castsi128_si256(low), high, 1);
+        }
+    }
+
+    inline itype iadd(itype a, itype b) noexcept { return detail::per_half(a, b, [](__m128i a, __m128i b) { return _mm_add_epi32(a, b); }); }
+    inline itype imul(itype a, itype b) noexcept { return detail::per_half(a, b, [](__m128i a, __m128i b) { return _mm_mullo_epi32(a, b); }); }
+    template <int N> inline itype shift_right(itype a) noexcept { return detail::per_half(a, a, [](__m128i a, __m128i) { return _mm_srli_epi32(a, N); }); }
+    #endif
+#elif defined(SIMD_SSE2)
+    using type = __m128;
+    constexpr size_t WIDTH = 4;
+
+    inline type load(const float* ptr) noexcept { return _mm_loadu_ps(ptr); }
+    inline void store(float* ptr, type value) noexcept { _mm_storeu_ps(ptr, value); }
+    inline type set(float value) noexcept { return _mm_set1_ps(value); }
+    inline type add(type a, type b) noexcept { return _mm_add_ps(a, b); }
+    inline type sub(type a, type b) noexcept { return _mm_sub_ps(a, b); }
+    inline type mul(type a, type b) noexcept { return _mm_mul_ps(a, b); }
+    inline type div(type a, type b) noexcept { return _mm_div_ps(a, b); }
+    inline type min(type a, type b) noexcept { return _mm_min_ps(a, b); }
+    inline type max(type a, type b) noexcept { return _mm_max_ps(a, b); }
+    inline type sqrt(type a) noexcept { return _mm_sqrt_ps(a); }
+    // NOTE: SSE2 has no rounding instructions, truncated values greater than a are one too big. Valid for |a| < 2^31
+    inline type floor(type a) noexcept {
+        const type truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+        return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, a), _mm_set1_ps(1.0f)));
+    }
+
+    using itype = __m128i;
+
+    // NOTE: truncates towards zero
+    inline itype to_int(type a) noexcept { return _mm_cvttps_epi32(a); }
+    inline type to_float(itype a) noexcept { return _mm_cvtepi32_ps(a); }
+    inline itype iset(uint32_t value) noexcept { return _mm_set1_epi32(static_cast<int32_t>(value)); }
+    inline void istore(int32_t* ptr, itype value) noexcept { _mm_storeu_si128(reinterpret_cast<__m128i*>(ptr), value); }
+    inline itype ixor(itype a, itype b) noexcept { return _mm_xor_si128(a, b); }
+    inline itype iadd(itype a, itype b) noexcept { return _mm_add_epi32(a, b); }
+    inline itype imul(itype a, itype b) noexcept {
+    #if defined(__SSE4_1__)
+        return _mm_mullo_epi32(a, b);
+    #else
+        // NOTE: SSE2 multiplies even lanes into 64-bit products only, odd lanes are shifted into even ones and low halves are interleaved back
+        const __m128i even = _mm_mul_epu32(a, b);
+        const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+        return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    #endif
+    }
+    template <int N> inline itype shift_right(itype a) noexcept { return _mm_srli_epi32(a, N); }
+#else
+    using type = float;
+    constexpr size_t WIDTH = 1;
+
+    inline type load(const float* ptr) noexcept { return *ptr; }
+    inline void store(float* ptr, type value) noexcept { *ptr = value; }
+    inline type set(float value) noexcept { return value; }
+    inline type add(type a, type b) noexcept { return a + b; }
+    inline type sub(type a, type b) noexcept { return a - b; }
+    inline type mul(type a, type b) noexcept { return a * b; }
+    inline type div(type a, type b) noexcept { return a / b; }
+    inline type min(type a, type b) noexcept { return a < b ? a : b; }
+    inline type max(type a, type b) noexcept { return a > b ? a : b; }
+    inline type sqrt(type a) noexcept { return std::sqrt(a); }
+    inline type floor(type a) noexcept { return std::floor(a); }
+
+    using itype = uint32_t;
+
+    // NOTE: truncates towards zero
+    inline itype to_int(type a) noexcept { return static_cast<uint32_t>(static_cast<int32_t>(a)); }
+    inline type to_float(itype a) noexcept { return static_cast<float>(static_cast<int32_t>(a)); }
+    inline itype iset(uint32_t value) noexcept { return value; }
+    inline void istore(int32_t* ptr, itype value) noexcept { *ptr = static_cast<int32_t>(value); }
+    inline itype ixor(itype a, itype b) noexcept { return a ^ b; }
+    inline itype iadd(itype a, itype b) noexcept { return a + b; }
+    inline itype imul(itype a, itype b) noexcept { return a * b; }
+    template <int N> inline itype shift_right(itype a) noexcept { return a >> N; }
+#endif
+
+    // a + (b - a) * t
+    inline type lerp(type a, type b, type t) noexcept { return add(a, mul(sub(b, a), t)); }
+}
@@ -0,0 +1,104 @@
+#include "spatial_hash.hpp"
+
+#include "debug.hpp"
+
+#include <algorithm>
+#include <limits>
+
+spatial_hash::spatial_hash(float cell_size) {
+    create(cell_size);
+}
+
+void spatial_hash::create(float cell_size) noexcept {
+    ASSERT(cell_size > 0.0f, "spatial_hash", "cell size must be greater than 0");
+
+    m_cell_size = cell_size;
+    m_inv_cell_size = 1.0f / cell_size;
+}
+
+void spatial_hash::build(const float* x, const float* y, const float* z, size_t count, thread_pool* pool) noexcept {
+    ASSERT(count < std::numeric_limits<uint32_t>::max(), "spatial_hash", "too many points");
+
+    // NOTE: about two buckets per point keeps collisions of different cells rare
+    size_t bucket_count = 64;
+    while (bucket_count < 2 * count) {
+        bucket_count <<= 1;
+    }
+    m_bucket_mask = static_cast<uint32_t>(bucket_count - 1);
+
+    if (m_bucket_capacity < bucket_count) {
+        m_bucket_counters = std::make_unique<std::atomic<uint32_t>[]>(bucket_count);
+        m_bucket_capacity = bucket_count;
+    }
+    m_bucket_starts.resize(bucket_count + 1);
+    m_point_buckets.resize(count);
+    m_sorted_points.resize(count);
+
+    std::atomic<uint32_t>* counters = m_bucket_counters.get();
+
+    parallel_for(pool, bucket_count, PARALLEL_GRAIN_SIZE, [counters](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            counters[i].store(0, std::memory_order_relaxed);
+        }
+    });
+
+    // Counting pass
+    parallel_for(pool, count, PARALLEL_GRAIN_SIZE, [this, x, y, z, counters](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const uint32_t bucket = _get_bucket(_get_cell(glm::vec3(x[i], y[i], z[i])));
+            m_point_buckets[i] = bucket;
+            counters[bucket].fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+
+    // Exclusive prefix sum: chunk sums, scan over chunks, then chunk-local scans
+    const size_t chunk_count = (bucket_count + PARALLEL_GRAIN_SIZE - 1) / PARALLEL_GRAIN_SIZE;
+    m_chunk_sums.resize(chunk_count);
+
+    parallel_for(pool, chunk_count, 1, [this, counters, bucket_count](size_t begin_chunk, size_t end_chunk) {
+        for (size_t chunk = begin_chunk; chunk < end_chunk; ++chunk) {
+            const size_t end = std::min((chunk + 1) * PARALLEL_GRAIN_SIZE, bucket_count);
+
+            uint32_t sum = 0;
+            for (size_t i = chunk * PARALLEL_GRAIN_SIZE; i < end; ++i) {
+                sum += counters[i].load(std::memory_order_relaxed);
+            }
+            m_chunk_sums[chunk] = sum;
+        }
+    });
+
+    uint32_t offset = 0;
+    for (uint32_t& sum : m_chunk_sums) {
+        const uint32_t chunk_sum = sum;
+        sum = offset;
+        offset += chunk_sum;
+    }
+
+    parallel_for(pool, chunk_count, 1, [this, counters, bucket_count](size_t begin_chunk, size_t end_chunk) {
+        for (size_t chunk = begin_chunk; chunk < end_chunk; ++chunk) {
+            const size_t end = std::min((chunk + 1) * PARALLEL_GRAIN_SIZE, bucket_count);
+
+            uint32_t start = m_chunk_sums[chunk];
+            for (size_t i = chunk * PARALLEL_GRAIN_SIZE; i < end; ++i) {
+                const uint32_t bucket_size = counters[i].load(std::memory_order_relaxed);
+                m_bucket_starts[i] = start;
+                // NOTE: counters become write cursors of the scatter pass
+                counters[i].store(start, std::memory_order_relaxed);
+                start += bucket_size;
+            }
+        }
+    });
+    m_bucket_starts[bucket_count] = static_cast<uint32_t>(count);
+
+    // Scatter pass, order of points inside of a bucket is unspecified
+    parallel_for(pool, count, PARALLEL_GRAIN_SIZE, [this, counters](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const uint32_t slot = counters[m_point_buckets[i]].fetch_add(1, std::memory_order_relaxed);
+            m_sorted_points[slot] = static_cast<uint32_t>(i);
+        }
+    });
+}
+
+float spatial_hash::get_cell_size() const noexcept {
+    return m_cell_size;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+// Uniform grid hashed into a table of buckets. Rebuilt from scratch by a parallel counting sort, so points of 
+// one bucket are stored contiguously and no per-cell containers are allocated
+class spatial_hash {
+public:
+    spatial_hash() = default;
+    spatial_hash(float cell_size);
+
+    void create(float cell_size) noexcept;
+
+    void build(const float* x, const float* y, const float* z, size_t count, thread_pool* pool = nullptr) noexcept;
+
+    // Calls func(index) for every point in 3x3x3 cells around position. Neighbours within cell size are guaranteed to be visited,
+    // points aren't filtered by distance
+    template <typename Func>
+    void for_each_candidate(const glm::vec3& position, const Func& func) const noexcept;
+
+    float get_cell_size() const noexcept;
+
+private:
+    glm::ivec3 _get_cell(const glm::vec3& position) const noexcept;
+    uint32_t _get_bucket(const glm::ivec3& cell) const noexcept;
+
+private:
+    static constexpr size_t PARALLEL_GRAIN_SIZE = 4096;
+
+    float m_cell_size = 1.0f;
+    float m_inv_cell_size = 1.0f;
+
+    uint32_t m_bucket_mask = 0;
+    std::vector<uint32_t> m_bucket_starts;
+    std::unique_ptr<std::atomic<uint32_t>[]> m_bucket_counters;
+    size_t m_bucket_capacity = 0;
+    std::vector<uint32_t> m_chunk_sums;
+
+    std::vector<uint32_t> m_point_buckets;
+    std::vector<uint32_t> m_sorted_points;
+};
+
+
+template <typename Func>
+inline void spatial_hash::for_each_candidate(const glm::vec3& position, const Func& func) const noexcept {
+    if (m_bucket_starts.empty()) {
+        return;
+    }
+
+    const glm::ivec3 center = _get_cell(position);
+
+    // NOTE: different cells may share a bucket, visited buckets are remembered to not report the same point twice
+    uint32_t visited[27];
+    size_t visited_count = 0;
+
+    for (int32_t z = -1; z <= 1; ++z) {
+        for (int32_t y = -1; y <= 1; ++y) {
+            for (int32_t x = -1; x <= 1; ++x) {
+                const uint32_t bucket = _get_bucket(center + glm::ivec3(x, y, z));
+
+                bool is_visited = false;
+                for (size_t i = 0; i < visited_count && !is_visited; ++i) {
+                    is_visited = visited[i] == bucket;
+                }
+                if (is_visited) {
+                    continue;
+                }
+                visited[visited_count++] = bucket;
+
+                for (uint32_t i = m_bucket_starts[bucket]; i < m_bucket_starts[bucket + 1]; ++i) {
+                    func(m_sorted_points[i]);
+                }
+            }
+        }
+    }
+}
+
+inline glm::ivec3 spatial_hash::_get_cell(const glm::vec3& position) const noexcept {
+    return glm::ivec3(glm::floor(position * m_inv_cell_size));
+}
+
+inline uint32_t spatial_hash::_get_bucket(const glm::ivec3& cell) const noexcept {
+    const uint32_t hash = (uint32_t(cell.x) * 73856093u) ^ (uint32_t(cell.y) * 19349663u) ^ (uint32_t(cell.z) * 83492791u);
+    return hash & m_bucket_mask;
+}
@@ -1,70 +1,150 @@
 #include "terrain.hpp"
+#include "debug.hpp"
+#include "mapped_file.hpp"
+#include "simd.hpp"
+
+#include <cstring>
+#include <cmath>
 
 #include <stb/stb_image.h>
 #include <stb/stb_image_write.h>
 
-terrain::terrain(const std::string_view height_map_path, float dudv) {
-    create(height_map_path, dudv);
+#include <glm/gtx/norm.hpp>
+
+namespace {
+    bool has_extension(const std::string_view path, const std::string_view extension) noexcept {
+        return path.size() >= extension.size() && path.substr(path.size() - extension.size()) == extension;
+    }
+
+    // Calls func(begin_row, end_row, band) for bands of band_rows rows of [0, row_count), bands are processed by the pool workers
+    template <typename Func>
+    void parallel_for_bands(thread_pool* pool, int32_t row_count, int32_t band_rows, const Func& func) noexcept {
+        const size_t band_count = (row_count + band_rows - 1) / band_rows;
+        parallel_for(pool, band_count, 1, [&](size_t begin_band, size_t end_band) {
+            for (size_t band = begin_band; band < end_band; ++band) {
+                const int32_t begin_row = static_cast<int32_t>(band) * band_rows;
+                func(begin_row, std::min(begin_row + band_rows, row_count), band);
+            }
+        });
+    }
+
+    bool is_aabb_in_sphere_range(const glm::vec3& min, const glm::vec3& max, const glm::vec3& center, float radius) noexcept {
+        const glm::vec3 closest = glm::clamp(center, min, max);
+        return glm::length2(closest - center) <= radius * radius;
+    }
 }
 
-void terrain::create(const std::string_view height_map_path, float dudv) noexcept {
-    int32_t channel_count;
-    uint8_t* height_map = stbi_load(height_map_path.data(), &width, &depth, &channel_count, 0);
+terrain_selection::terrain_selection(size_t max_patch_count) {
+    create(max_patch_count);
+}
 
-    ASSERT(height_map != nullptr, "terrain", stbi_failure_reason());
+void terrain_selection::create(size_t max_patch_count) noexcept {
+    ASSERT(max_patch_count > 0, "terrain_selection", "max_patch_count is equal 0");
 
-    if (width == 0 || depth == 0) {
-        stbi_image_free(height_map);
+    m_patches.reserve(max_patch_count);
+    m_patches_ring.create(GL_SHADER_STORAGE_BUFFER, max_patch_count * sizeof(glm::vec4), sizeof(glm::vec4));
+}
+
+void terrain_selection::destroy() noexcept {
+    m_patches_ring.destroy();
+    m_patches.clear();
+    m_morph_ranges.clear();
+}
+
+void terrain_selection::upload() noexcept {
+    if (m_patches.empty()) {
         return;
     }
 
+    ASSERT(m_patches.size() * sizeof(glm::vec4) <= m_patches_ring.get_region_size(), "terrain_selection", "too many patches");
+    memcpy(m_patches_ring.next_region(), m_patches.data(), m_patches.size() * sizeof(glm::vec4));
+}
+
+size_t terrain_selection::get_patch_count() const noexcept {
+    return m_patches.size();
+}
+
+
+terrain::terrain(const std::string_view height_map_path, float dudv, thread_pool* pool, int32_t raw_width) {
+    create(height_map_path, dudv, pool, raw_width);
+}
+
+void terrain::create(const std::string_view height_map_path, float dudv, thread_pool* pool, int32_t raw_width) noexcept {
     ASSERT(dudv > 0.0f, "terrain", "dudv must be greater than zero");
+    this->dudv = dudv;
 
-    std::vector<mesh::vertex> vertices(width * depth);
-    this->heights.resize(vertices.size());
-    for (uint32_t z = 0; z < depth; ++z) {
-        for (uint32_t x = 0; x < width; ++x) {
-            const size_t index = z * width * channel_count + x * channel_count;
-            const float height = height_map[index + 1];
+    _load(height_map_path, raw_width, pool, true);
 
-            min_height = std::min(min_height, height);
-            max_height = std::max(max_height, height);
+    if (width == 0 || depth == 0) {
+        return;
+    }
 
-            this->heights[z * width + x] = height;
+    _calculate_lod_errors(pool);
+    _calculate_chunk_bounds(pool);
 
-            mesh::vertex& vertex = vertices[z * width + x];
-            vertex.position = glm::vec3(x, height, z);
-            vertex.texcoord = glm::vec2(x * dudv, (depth - 1 - z) * dudv);
-        }
+    height_texture.set_parameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    height_texture.set_parameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    height_texture.set_parameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    height_texture.set_parameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    _create_normal_map(pool);
+    create_grid(grid_vao, grid_ibo);
+}
+
+void terrain::load_heights(const std::string_view height_map_path, thread_pool* pool, int32_t raw_width) noexcept {
+    load_samples(height_map_path, pool, raw_width);
+
+    if (width == 0 || depth == 0) {
+        return;
     }
-    stbi_image_free(height_map);
 
-    const auto indices = _generate_mesh_indices(width, depth);
-    _calculate_normals(vertices, indices);
+    _calculate_lod_errors(pool);
+    _calculate_chunk_bounds(pool);
+}
 
-    ground_mesh.create(vertices, indices);
+void terrain::load_samples(const std::string_view height_map_path, thread_pool* pool, int32_t raw_width) noexcept {
+    _load(height_map_path, raw_width, pool, false);
 }
 
-void terrain::create_water_mesh(float height) noexcept {
-    std::vector<mesh::vertex> vertices(width * depth);
-    
-    for (uint32_t z = 0; z < depth; ++z) {
-        for (uint32_t x = 0; x < width; ++x) {
-            mesh::vertex& vertex = vertices[z * width + x];
-            vertex.position = glm::vec3(x, height, z);
-            vertex.normal = glm::vec3(0.0f, 1.0f, 0.0f);
-            vertex.texcoord = glm::vec2(x / static_cast<float>(width - 1), (depth - 1 - z) / static_cast<float>(depth - 1));
-        }
+float terrain::get_lod_error(int32_t lod) const noexcept {
+    ASSERT(lod >= 0 && lod <= m_lod_count, "terrain", "lod is out of range");
+    return m_lod_errors[lod];
+}
+
+glm::vec2 terrain::get_chunk_bounds(int32_t x, int32_t z, int32_t lod) const noexcept {
+    ASSERT(lod >= 0 && lod < m_lod_count, "terrain", "lod is out of range");
+
+    const int32_t size = CHUNK_SIZE << lod;
+    const int32_t chunk_count_x = (width - 1 + size - 1) / size;
+    return m_chunk_bounds[lod][(z / size) * chunk_count_x + x / size];
+}
+
+float terrain::get_sample(int32_t x, int32_t z) const noexcept {
+    const size_t index = size_t(z) * width + x;
+    return m_float_samples != nullptr ? m_float_samples[index] : static_cast<float>(m_r16_samples[index]) * HEIGHT_16_BIT_SCALE;
+}
+
+const float* terrain::get_row(int32_t z, float* buffer) const noexcept {
+    if (m_float_samples != nullptr) {
+        return m_float_samples + size_t(z) * width;
     }
 
-    water_mesh.create(vertices, _generate_mesh_indices(width, depth));
+    const uint16_t* samples = m_r16_samples + size_t(z) * width;
+    for (int32_t x = 0; x < width; ++x) {
+        buffer[x] = static_cast<float>(samples[x]) * HEIGHT_16_BIT_SCALE;
+    }
+    return buffer;
+}
+
+bool terrain::has_heights() const noexcept {
+    return m_float_samples != nullptr || m_r16_samples != nullptr;
 }
 
 float terrain::get_height(float local_x, float local_z) const noexcept {
     if (!_belongs_terrain(local_x, local_z)) {
         return std::numeric_limits<float>::lowest();
     }
-    return heights[size_t(local_z) * width + size_t(local_x)];
+    return get_sample(static_cast<int32_t>(local_x), static_cast<int32_t>(local_z));
 }
 
 float terrain::get_interpolated_height(float local_x, float local_z) const noexcept {
@@ -116,50 +196,469 @@ void terrain::calculate_tile_regions(size_t tiles_count, const std::string* tile
     }
 }
 
-std::vector<uint32_t> terrain::_generate_mesh_indices(int32_t width, int32_t depth) const noexcept {
-    std::vector<uint32_t> indices;
-    indices.reserve((width - 1) * (depth - 1) * 6);
-    for (uint32_t z = 0; z < depth - 1; ++z) {
-        for (uint32_t x = 0; x < width - 1; ++x) {
-            indices.emplace_back(z * width + x);
-            indices.emplace_back((z + 1) * width + x);
-            indices.emplace_back(z * width + (x + 1));
+void terrain::select(terrain_selection& selection, const glm::vec3& camera_position, float projection_scale, float max_pixel_error, 
+    const frustum* frustum
+) const noexcept {
+    ASSERT(max_pixel_error > 0.0f, "terrain", "max_pixel_error must be greater than zero");
+
+    selection.m_patches.clear();
+    selection.m_camera_position = camera_position;
+
+    if (m_lod_count == 0) {
+        return;
+    }
+
+    // NOTE: level L is used up to the distance its successor's error becomes small enough on screen. Every range is at least
+    // twice as long as the previous one, so neighbouring chunks never differ by more than one level
+    const float error_to_distance = projection_scale / max_pixel_error;
+
+    std::vector<float> ranges(m_lod_count);
+    for (int32_t lod = 0; lod < m_lod_count; ++lod) {
+        const float min_range = lod == 0 ? 2.0f * CHUNK_SIZE : 2.0f * ranges[lod - 1];
+        ranges[lod] = std::max(m_lod_errors[lod + 1] * error_to_distance, min_range);
+    }
+    ranges.back() = std::numeric_limits<float>::max();
+
+    _calculate_morph_ranges(selection, ranges);
+
+    _select_chunk(selection, 0, 0, m_lod_count - 1, selection_context{ ranges, frustum, false });
+}
+
+void terrain::select_water(terrain_selection& selection, const glm::vec3& camera_position, const frustum* frustum) const noexcept {
+    selection.m_patches.clear();
+    selection.m_camera_position = camera_position;
+
+    if (m_lod_count == 0) {
+        return;
+    }
+
+    std::vector<float> ranges(m_lod_count);
+    for (int32_t lod = 0; lod < m_lod_count; ++lod) {
+        ranges[lod] = lod == 0 ? 2.0f * CHUNK_SIZE : 2.0f * ranges[lod - 1];
+    }
+    ranges.back() = std::numeric_limits<float>::max();
+
+    _calculate_morph_ranges(selection, ranges);
+
+    _select_chunk(selection, 0, 0, m_lod_count - 1, selection_context{ ranges, frustum, true });
+}
+
+size_t terrain::get_max_patch_count() const noexcept {
+    const size_t chunk_count_x = (width - 1 + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    const size_t chunk_count_z = (depth - 1 + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+    // NOTE: every patch covers at least one quadrant of the finest chunks
+    return 4 * chunk_count_x * chunk_count_z;
+}
+
+int32_t terrain::get_lod_count() const noexcept {
+    return m_lod_count;
+}
+
+int32_t terrain::calculate_lod_count(int32_t width, int32_t depth) noexcept {
+    int32_t lod_count = 1;
+    while ((CHUNK_SIZE << (lod_count - 1)) < std::max(width - 1, depth - 1)) {
+        ++lod_count;
+    }
+    return lod_count;
+}
+
+void terrain::create_grid(vertex_array& vao, buffer& ibo) noexcept {
+    // NOTE: strip of row z goes (x, z), (x, z + 1), (x + 1, z), ..., so triangles keep the winding of the former triangle list
+    std::vector<uint16_t> indices;
+    indices.reserve(PATCH_SIZE * (2 * (PATCH_SIZE + 1) + 1));
+    for (int32_t z = 0; z < PATCH_SIZE; ++z) {
+        if (z > 0) {
+            indices.emplace_back(PRIMITIVE_RESTART_INDEX);
+        }
+
+        for (int32_t x = 0; x <= PATCH_SIZE; ++x) {
+            indices.emplace_back(static_cast<uint16_t>(z * (PATCH_SIZE + 1) + x));
+            indices.emplace_back(static_cast<uint16_t>((z + 1) * (PATCH_SIZE + 1) + x));
+        }
+    }
+
+    // NOTE: there are no vertex attributes, shaders take grid coordinates from gl_VertexID
+    vao.create();
+    vao.bind();
+
+    ibo.create(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(indices[0]), sizeof(indices[0]), GL_STATIC_DRAW, indices.data());
+    ibo.bind();
+
+    vao.unbind();
+}
+
+template <typename T>
+void terrain::_decode_heights(const T* samples, float scale, thread_pool* pool) noexcept {
+    m_decoded_heights.resize(size_t(width) * depth);
 
-            indices.emplace_back(z * width + (x + 1));
-            indices.emplace_back((z + 1) * width + x);
-            indices.emplace_back((z + 1) * width + (x + 1));
+    parallel_for_bands(pool, depth, BUILD_BAND_ROWS, [&](int32_t begin_z, int32_t end_z, size_t) {
+        for (size_t i = size_t(begin_z) * width; i < size_t(end_z) * width; ++i) {
+            m_decoded_heights[i] = static_cast<float>(samples[i]) * scale;
         }
+    });
+
+    m_float_samples = m_decoded_heights.data();
+}
+
+void terrain::_calculate_height_range(thread_pool* pool) noexcept {
+    // NOTE: every band keeps its own min (x) and max (y) heights, they are merged afterwards
+    std::vector<glm::vec2> band_bounds((depth + BUILD_BAND_ROWS - 1) / BUILD_BAND_ROWS);
+    parallel_for_bands(pool, depth, BUILD_BAND_ROWS, [&](int32_t begin_z, int32_t end_z, size_t band) {
+        std::vector<float> row_buffer(width);
+
+        glm::vec2 bounds(std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest());
+        for (int32_t z = begin_z; z < end_z; ++z) {
+            const float* row = get_row(z, row_buffer.data());
+            for (int32_t x = 0; x < width; ++x) {
+                bounds.x = std::min(bounds.x, row[x]);
+                bounds.y = std::max(bounds.y, row[x]);
+            }
+        }
+        band_bounds[band] = bounds;
+    });
+
+    min_height = std::numeric_limits<float>::max();
+    max_height = std::numeric_limits<float>::lowest();
+    for (const glm::vec2& bounds : band_bounds) {
+        min_height = std::min(min_height, bounds.x);
+        max_height = std::max(max_height, bounds.y);
     }
+}
 
-    return indices;
+void terrain::_load(const std::string_view height_map_path, int32_t raw_width, thread_pool* pool, bool create_height_texture) noexcept {
+    m_decoded_heights.clear();
+    m_height_file.destroy();
+    m_float_samples = nullptr;
+    m_r16_samples = nullptr;
+    m_lod_errors.clear();
+    m_chunk_bounds.clear();
+    width = depth = 0;
+
+    if (has_extension(height_map_path, ".r16") || has_extension(height_map_path, ".f32")) {
+        _load_raw(height_map_path, raw_width, pool, create_height_texture);
+    } else {
+        _load_image(height_map_path, pool, create_height_texture);
+    }
+
+    if (!has_heights()) {
+        width = depth = 0;
+        return;
+    }
+
+    m_lod_count = calculate_lod_count(width, depth);
+    ASSERT(m_lod_count <= MAX_LOD_COUNT, "terrain", "height map is too big");
 }
 
-void terrain::_calculate_normals(std::vector<mesh::vertex> &vertices, const std::vector<std::uint32_t> &indices) noexcept
-{
-    struct vertex_normals_sum {
-        glm::vec3 sum = glm::vec3(0.0f);
-        uint32_t count = 0;
+void terrain::_load_image(const std::string_view height_map_path, thread_pool* pool, bool create_height_texture) noexcept {
+    const std::string filepath(height_map_path);
+
+    // NOTE: stb converts images to a single grey channel, 16-bit ones keep their precision
+    int32_t channel_count;
+    if (stbi_is_16_bit(filepath.c_str())) {
+        uint16_t* samples = stbi_load_16(filepath.c_str(), &width, &depth, &channel_count, 1);
+        ASSERT(samples != nullptr, "terrain", stbi_failure_reason());
+
+        if (samples != nullptr) {
+            _decode_heights(samples, HEIGHT_16_BIT_SCALE, pool);
+            _calculate_height_range(pool);
+            if (create_height_texture) {
+                _create_height_texture(GL_R16, GL_UNSIGNED_SHORT, samples, glm::vec2(0.0f, UINT16_MAX * HEIGHT_16_BIT_SCALE));
+            }
+        }
+        stbi_image_free(samples);
+    } else {
+        uint8_t* samples = stbi_load(filepath.c_str(), &width, &depth, &channel_count, 1);
+        ASSERT(samples != nullptr, "terrain", stbi_failure_reason());
+
+        if (samples != nullptr) {
+            _decode_heights(samples, 1.0f, pool);
+            _calculate_height_range(pool);
+            if (create_height_texture) {
+                _create_height_texture(GL_R8, GL_UNSIGNED_BYTE, samples, glm::vec2(0.0f, UINT8_MAX));
+            }
+        }
+        stbi_image_free(samples);
+    }
+}
+
+void terrain::_load_raw(const std::string_view height_map_path, int32_t raw_width, thread_pool* pool, bool create_height_texture) noexcept {
+    m_height_file.create(std::string(height_map_path));
+    if (!m_height_file.is_valid()) {
+        return;
+    }
+
+    const bool is_float = has_extension(height_map_path, ".f32");
+    const size_t sample_size = is_float ? sizeof(float) : sizeof(uint16_t);
+    const size_t sample_count = m_height_file.get_size() / sample_size;
+
+    // NOTE: raw files have no header, they are square unless the width is given
+    const int32_t file_width = raw_width > 0 ? raw_width : static_cast<int32_t>(std::lround(std::sqrt(double(sample_count))));
+    if (m_height_file.get_size() % sample_size != 0 || file_width == 0 || sample_count % file_width != 0) {
+        ASSERT(false, "terrain", "size of raw height map \"" + std::string(height_map_path) + "\" doesn't match its width");
+        m_height_file.destroy();
+        return;
+    }
+
+    width = file_width;
+    depth = static_cast<int32_t>(sample_count / file_width);
+
+    // NOTE: samples are read right from the mapping, which is kept alive. Both formats are little-endian, mappings are page-aligned
+    if (is_float) {
+        m_float_samples = reinterpret_cast<const float*>(m_height_file.get_data());
+    } else {
+        m_r16_samples = reinterpret_cast<const uint16_t*>(m_height_file.get_data());
+    }
+    _calculate_height_range(pool);
+
+    if (!create_height_texture) {
+        return;
+    }
+
+    if (is_float) {
+        // NOTE: float heights are stored normalized to [min_height, max_height] in 16 bits, it's the only copy of the map
+        const float height_range = std::max(max_height - min_height, std::numeric_limits<float>::epsilon());
+        std::vector<uint16_t> normalized_heights(size_t(width) * depth);
+        parallel_for_bands(pool, depth, BUILD_BAND_ROWS, [&](int32_t begin_z, int32_t end_z, size_t) {
+            for (size_t i = size_t(begin_z) * width; i < size_t(end_z) * width; ++i) {
+                normalized_heights[i] = static_cast<uint16_t>(std::round((m_float_samples[i] - min_height) / height_range * 65535.0f));
+            }
+        });
+
+        _create_height_texture(GL_R16, GL_UNSIGNED_SHORT, normalized_heights.data(), glm::vec2(min_height, min_height + height_range));
+    } else {
+        _create_height_texture(GL_R16, GL_UNSIGNED_SHORT, m_r16_samples, glm::vec2(0.0f, UINT16_MAX * HEIGHT_16_BIT_SCALE));
+    }
+}
+
+void terrain::_create_height_texture(GLenum internal_format, GLenum type, const void* samples, const glm::vec2& range) noexcept {
+    // NOTE: rows of 8 and 16-bit samples aren't 4-byte aligned for every width
+    OGL_CALL(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+    height_texture.create(width, depth, 0, internal_format, GL_RED, type, samples);
+    OGL_CALL(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+
+    height_texture_range = range;
+}
+
+void terrain::_create_normal_map(thread_pool* pool) noexcept {
+    std::vector<int8_t> normals(size_t(width) * depth * 2);
+
+    // NOTE: normal = normalize(left - right, 2, back - front) is computed for the rows of 4 neighbours loaded as they are in memory,
+    // border samples are clamped to the edge like the height texture samples are
+    parallel_for_bands(pool, depth, BUILD_BAND_ROWS, [&](int32_t begin_z, int32_t end_z, size_t) {
+        std::vector<float> padded_row(width + 2);
+        std::vector<float> back_buffer(width);
+        std::vector<float> front_buffer(width);
+        std::vector<float> normals_x(width);
+        std::vector<float> normals_z(width);
+
+        const simd::type four_v = simd::set(4.0f);
+
+        for (int32_t z = begin_z; z < end_z; ++z) {
+            const float* back_row = get_row(std::max(z - 1, 0), back_buffer.data());
+            const float* front_row = get_row(std::min(z + 1, depth - 1), front_buffer.data());
+
+            const float* row = get_row(z, padded_row.data() + 1);
+            if (row != padded_row.data() + 1) {
+                memcpy(padded_row.data() + 1, row, width * sizeof(float));
+            }
+            padded_row.front() = row[0];
+            padded_row.back() = row[width - 1];
+            const float* left_row = padded_row.data();
+            const float* right_row = padded_row.data() + 2;
+
+            int32_t x = 0;
+            for (; x + int32_t(simd::WIDTH) <= width; x += int32_t(simd::WIDTH)) {
+                const simd::type dx_v = simd::sub(simd::load(left_row + x), simd::load(right_row + x));
+                const simd::type dz_v = simd::sub(simd::load(back_row + x), simd::load(front_row + x));
+                const simd::type length_v = simd::sqrt(simd::add(simd::add(simd::mul(dx_v, dx_v), simd::mul(dz_v, dz_v)), four_v));
+                simd::store(normals_x.data() + x, simd::div(dx_v, length_v));
+                simd::store(normals_z.data() + x, simd::div(dz_v, length_v));
+            }
+            for (; x < width; ++x) {
+                const float dx = left_row[x] - right_row[x];
+                const float dz = back_row[x] - front_row[x];
+                const float length = std::sqrt(dx * dx + dz * dz + 4.0f);
+                normals_x[x] = dx / length;
+                normals_z[x] = dz / length;
+            }
+
+            int8_t* normals_row = normals.data() + size_t(z) * width * 2;
+            for (x = 0; x < width; ++x) {
+                normals_row[2 * x + 0] = static_cast<int8_t>(std::lround(normals_x[x] * 127.0f));
+                normals_row[2 * x + 1] = static_cast<int8_t>(std::lround(normals_z[x] * 127.0f));
+            }
+        }
+    });
+
+    // NOTE: y is always positive, the shader restores it from x and z
+    OGL_CALL(glPixelStorei(GL_UNPACK_ALIGNMENT, 2));
+    normal_texture.create(width, depth, 0, GL_RG8_SNORM, GL_RG, GL_BYTE, normals.data());
+    OGL_CALL(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+    normal_texture.set_parameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    normal_texture.set_parameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    normal_texture.set_parameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    normal_texture.set_parameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+void terrain::_calculate_lod_errors(thread_pool* pool) noexcept {
+    const auto height = [this](int32_t x, int32_t z) {
+        return get_sample(std::min(x, width - 1), std::min(z, depth - 1));
     };
 
-    std::vector<vertex_normals_sum> averaged_normals(vertices.size());
+    // NOTE: level L keeps every 2^L-th sample, the dropped samples of the previous level are replaced by 
+    // linear interpolation of their kept neighbours, errors of consecutive levels add up
+    m_lod_errors.assign(m_lod_count + 1, 0.0f);
+    for (int32_t lod = 1; lod <= m_lod_count; ++lod) {
+        const int32_t step = 1 << (lod - 1);
+        const int32_t row_count = (depth + step - 1) / step;
+
+        std::vector<float> band_errors((row_count + BUILD_BAND_ROWS - 1) / BUILD_BAND_ROWS, 0.0f);
+        parallel_for_bands(pool, row_count, BUILD_BAND_ROWS, [&](int32_t begin_row, int32_t end_row, size_t band) {
+            float error = 0.0f;
+            for (int32_t z = begin_row * step; z < end_row * step; z += step) {
+                for (int32_t x = 0; x < width; x += step) {
+                    const bool is_odd_x = (x / step) % 2 != 0;
+                    const bool is_odd_z = (z / step) % 2 != 0;
+
+                    float interpolated_height;
+                    if (is_odd_x && is_odd_z) {
+                        interpolated_height = 0.25f * (height(x - step, z - step) + height(x + step, z - step) + height(x - step, z + step) + height(x + step, z + step));
+                    } else if (is_odd_x) {
+                        interpolated_height = 0.5f * (height(x - step, z) + height(x + step, z));
+                    } else if (is_odd_z) {
+                        interpolated_height = 0.5f * (height(x, z - step) + height(x, z + step));
+                    } else {
+                        continue;
+                    }
+
+                    error = std::max(error, std::abs(height(x, z) - interpolated_height));
+                }
+            }
+            band_errors[band] = error;
+        });
+
+        m_lod_errors[lod] = m_lod_errors[lod - 1] + *std::max_element(band_errors.begin(), band_errors.end());
+    }
+}
+
+void terrain::_calculate_chunk_bounds(thread_pool* pool) noexcept {
+    m_chunk_bounds.resize(m_lod_count);
+
+    for (int32_t lod = 0; lod < m_lod_count; ++lod) {
+        const int32_t size = CHUNK_SIZE << lod;
+        const int32_t chunk_count_x = (width - 1 + size - 1) / size;
+        const int32_t chunk_count_z = (depth - 1 + size - 1) / size;
+
+        std::vector<glm::vec2>& level_bounds = m_chunk_bounds[lod];
+        level_bounds.assign(chunk_count_x * chunk_count_z, glm::vec2(std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest()));
+
+        if (lod == 0) {
+            // NOTE: rows of the finest chunks scan the whole height map, so they are split between the pool workers.
+            // Edge samples are shared with the neighbours, they are the chunk's vertices too
+            parallel_for(pool, chunk_count_z, 1, [&](size_t begin_chunk_z, size_t end_chunk_z) {
+                std::vector<float> row_buffer(width);
+
+                for (int32_t chunk_z = static_cast<int32_t>(begin_chunk_z); chunk_z < static_cast<int32_t>(end_chunk_z); ++chunk_z) {
+                    const int32_t last_z = std::min((chunk_z + 1) * size, depth - 1);
+
+                    for (int32_t z = chunk_z * size; z <= last_z; ++z) {
+                        const float* row = get_row(z, row_buffer.data());
+
+                        for (int32_t chunk_x = 0; chunk_x < chunk_count_x; ++chunk_x) {
+                            glm::vec2& bounds = level_bounds[chunk_z * chunk_count_x + chunk_x];
+                            const int32_t last_x = std::min((chunk_x + 1) * size, width - 1);
+
+                            for (int32_t x = chunk_x * size; x <= last_x; ++x) {
+                                bounds.x = std::min(bounds.x, row[x]);
+                                bounds.y = std::max(bounds.y, row[x]);
+                            }
+                        }
+                    }
+                }
+            });
+            continue;
+        }
+
+        const std::vector<glm::vec2>& child_bounds = m_chunk_bounds[lod - 1];
+        const int32_t child_count_x = (width - 1 + size / 2 - 1) / (size / 2);
+        const int32_t child_count_z = (depth - 1 + size / 2 - 1) / (size / 2);
+
+        for (int32_t chunk_z = 0; chunk_z < chunk_count_z; ++chunk_z) {
+            for (int32_t chunk_x = 0; chunk_x < chunk_count_x; ++chunk_x) {
+                glm::vec2& bounds = level_bounds[chunk_z * chunk_count_x + chunk_x];
+
+                for (int32_t child_z = 2 * chunk_z; child_z < std::min(2 * chunk_z + 2, child_count_z); ++child_z) {
+                    for (int32_t child_x = 2 * chunk_x; child_x < std::min(2 * chunk_x + 2, child_count_x); ++child_x) {
+                        const glm::vec2& child = child_bounds[child_z * child_count_x + child_x];
+                        bounds.x = std::min(bounds.x, child.x);
+                        bounds.y = std::max(bounds.y, child.y);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void terrain::_calculate_morph_ranges(terrain_selection& selection, const std::vector<float>& ranges) const noexcept {
+    selection.m_morph_ranges.resize(ranges.size());
+    for (size_t lod = 0; lod < ranges.size(); ++lod) {
+        const float range_start = lod == 0 ? 0.0f : ranges[lod - 1];
+        selection.m_morph_ranges[lod] = glm::vec2(range_start + (ranges[lod] - range_start) * MORPH_START_RATIO, ranges[lod]);
+    }
+    selection.m_morph_ranges.back() = glm::vec2(std::numeric_limits<float>::max());
+}
+
+bool terrain::_select_chunk(terrain_selection& selection, int32_t x, int32_t z, int32_t lod, const selection_context& context) const noexcept {
+    // NOTE: chunks outside of the height map have nothing to draw, so they are treated as selected
+    if (x >= width - 1 || z >= depth - 1) {
+        return true;
+    }
+
+    const int32_t size = CHUNK_SIZE << lod;
+    const std::vector<glm::vec2>& level_bounds = m_chunk_bounds[lod];
+    const int32_t chunk_count_x = (width - 1 + size - 1) / size;
+    const glm::vec2 bounds = context.is_water ? glm::vec2(water_height) : level_bounds[(z / size) * chunk_count_x + x / size];
+
+    const glm::vec3 min(x, bounds.x, z);
+    const glm::vec3 max(std::min(x + size, width - 1), bounds.y, std::min(z + size, depth - 1));
+
+    if (!is_aabb_in_sphere_range(min, max, selection.m_camera_position, context.ranges[lod])) {
+        return false;
+    }
+
+    // NOTE: invisible chunk is selected with nothing to draw, so that its parent doesn't draw the quadrant instead
+    if (context.view_frustum != nullptr && !context.view_frustum->is_aabb_visible(min, max)) {
+        return true;
+    }
 
-    for (size_t i = 0; i < indices.size(); i += 3) {
-        const glm::vec3 e0 = glm::normalize(vertices[indices[i + 0]].position - vertices[indices[i + 1]].position);
-        const glm::vec3 e1 = glm::normalize(vertices[indices[i + 2]].position - vertices[indices[i + 1]].position);
-            
-        const glm::vec3 normal = glm::cross(e1, e0);
+    const int32_t half_size = size / 2;
 
-        averaged_normals[indices[i + 0]].sum += normal;
-        averaged_normals[indices[i + 1]].sum += normal;
-        averaged_normals[indices[i + 2]].sum += normal;
-        ++averaged_normals[indices[i + 0]].count;
-        ++averaged_normals[indices[i + 1]].count;
-        ++averaged_normals[indices[i + 2]].count;
+    if (lod == 0 || !is_aabb_in_sphere_range(min, max, selection.m_camera_position, context.ranges[lod - 1])) {
+        for (int32_t quadrant = 0; quadrant < 4; ++quadrant) {
+            _add_patch(selection, x + (quadrant % 2) * half_size, z + (quadrant / 2) * half_size, lod);
+        }
+        return true;
     }
 
-    for (size_t i = 0; i < vertices.size(); ++i) {
-        vertices[i].normal = glm::normalize(averaged_normals[i].sum / static_cast<float>(averaged_normals[i].count));
+    // NOTE: children out of their range are drawn by quadrants of this chunk
+    for (int32_t quadrant = 0; quadrant < 4; ++quadrant) {
+        const int32_t child_x = x + (quadrant % 2) * half_size;
+        const int32_t child_z = z + (quadrant / 2) * half_size;
+        if (!_select_chunk(selection, child_x, child_z, lod - 1, context)) {
+            _add_patch(selection, child_x, child_z, lod);
+        }
     }
+
+    return true;
+}
+
+void terrain::_add_patch(terrain_selection& selection, int32_t x, int32_t z, int32_t lod) const noexcept {
+    if (x >= width - 1 || z >= depth - 1) {
+        return;
+    }
+
+    selection.m_patches.emplace_back(glm::vec4(x, z, 1 << lod, lod));
 }
 
 bool terrain::_belongs_terrain(float local_x, float local_z) const noexcept {
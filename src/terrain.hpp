@@ -1,23 +1,133 @@
 #pragma once
+#include <vector>
+#include <string_view>
 
-#include "mesh.hpp"
+#include <glm/glm.hpp>
 
+#include "texture.hpp"
+#include "vertex_array.hpp"
+#include "ring_buffer.hpp"
+#include "frustum.hpp"
+#include "thread_pool.hpp"
+#include "mapped_file.hpp"
 
+
+// Patches of the terrain chosen to be drawn from one point of view, see terrain::select()
+class terrain_selection : public nocopyable {
+    friend struct terrain;
+    friend class terrain_streamer;
+    friend class terrain_clipmap;
+    friend class renderer;
+public:
+    terrain_selection() = default;
+    terrain_selection(size_t max_patch_count);
+
+    void create(size_t max_patch_count) noexcept;
+    void destroy() noexcept;
+
+    // Must be called from the thread which owns the OpenGL context
+    void upload() noexcept;
+
+    size_t get_patch_count() const noexcept;
+
+private:
+    // NOTE: xy - patch origin in height map texels, z - distance between patch vertices in texels, w - LOD level
+    std::vector<glm::vec4> m_patches;
+    // NOTE: x - distance the patch vertices start to morph into the next LOD level at, y - distance they finish at
+    std::vector<glm::vec2> m_morph_ranges;
+    glm::vec3 m_camera_position = glm::vec3(0.0f);
+
+    ring_buffer m_patches_ring;
+};
+
+
+// Continuous distance-dependent LOD terrain (Strugar 2009). Height map is split into CHUNK_SIZE quads chunks
+// organized in a quadtree, chunk of level L covers CHUNK_SIZE * 2^L texels and is drawn with the same grid of CHUNK_SIZE quads.
+// Levels are chosen by distance at which their geometric error becomes smaller than the allowed screen-space error,
+// vertices morph into the next level near the end of their range, so there are neither cracks nor popping
 struct terrain {
+    static constexpr int32_t CHUNK_SIZE = 64;
+    // NOTE: chunks are drawn by quadrants, so that a chunk can be partially replaced by its children
+    static constexpr int32_t PATCH_SIZE = CHUNK_SIZE / 2;
+    static constexpr int32_t HEIGHT_MAP_UNIT = 15;
+    static constexpr int32_t NORMAL_MAP_UNIT = 16;
+    static constexpr uint16_t PRIMITIVE_RESTART_INDEX = 0xFFFF;
+    // NOTE: matches MAX_LOD_COUNT in terrain shaders
+    static constexpr int32_t MAX_LOD_COUNT = 16;
+
+    // NOTE: vertices start morphing at this part of the LOD range
+    static constexpr float MORPH_START_RATIO = 0.7f;
+    // NOTE: height map rows are processed by bands of this many rows during create()
+    static constexpr int32_t BUILD_BAND_ROWS = 64;
+    // NOTE: 16-bit samples are scaled into the range of 8-bit ones, so that a map gives the same terrain in both precisions
+    static constexpr float HEIGHT_16_BIT_SCALE = 1.0f / 256.0f;
+
     terrain() = default;
-    terrain(const std::string_view height_map_path, float dudv);
+    terrain(const std::string_view height_map_path, float dudv, thread_pool* pool = nullptr, int32_t raw_width = 0);
+
+    // Loads 8 or 16-bit images (grey or the luminance of colored ones) and headerless little-endian .r16 (uint16) and .f32 (float) files.
+    // Raw files are square unless raw_width is given, they stay memory-mapped and their samples are read in place, images are decoded into floats.
+    // Height map processing is split into bands of rows processed by the pool workers, nullptr builds on the calling thread
+    void create(const std::string_view height_map_path, float dudv, thread_pool* pool = nullptr, int32_t raw_width = 0) noexcept;
+    // Loads heights, LOD errors and chunk bounds the same way create() does without any OpenGL objects, the terrain can't be drawn.
+    // Used by tools which preprocess height maps
+    void load_heights(const std::string_view height_map_path, thread_pool* pool = nullptr, int32_t raw_width = 0) noexcept;
+    // Same as load_heights() but only the heights, their range and the LOD count are loaded, LOD errors and chunk bounds are not calculated.
+    // Used by terrain_pyramid::write() which computes them while streaming rows
+    void load_samples(const std::string_view height_map_path, thread_pool* pool = nullptr, int32_t raw_width = 0) noexcept;
 
-    void create(const std::string_view height_map_path, float dudv) noexcept;
-    void create_water_mesh(float height) noexcept;
+    // Height of texel (x, z), both must be inside the height map
+    float get_sample(int32_t x, int32_t z) const noexcept;
+    // Heights of row z. Rows of images and .f32 maps are returned in place, rows of .r16 maps are decoded into buffer of width floats
+    const float* get_row(int32_t z, float* buffer) const noexcept;
+    bool has_heights() const noexcept;
 
     float get_height(float local_x, float local_z) const noexcept;
     float get_interpolated_height(float local_x, float local_z) const noexcept;
 
     void calculate_tile_regions(size_t tiles_count, const std::string* tile_texture_paths = nullptr) noexcept;
 
+    // Chooses chunks and their LOD levels seen from camera_position given in the terrain local space.
+    // projection_scale = viewport height / (2 * tan(fov / 2)). Model matrix of the terrain must keep uniform scale.
+    // Chunks outside of frustum are skipped, it must be built from proj_view * model to be in the local space too, nullptr disables culling.
+    // Shadow passes use the camera position of the main pass with the cascade frustum, so that both passes morph the same way
+    void select(terrain_selection& selection, const glm::vec3& camera_position, float projection_scale, float max_pixel_error = 2.0f, 
+        const frustum* frustum = nullptr) const noexcept;
+    // Water is flat, so its chunks are chosen by distance only, to keep far water coarse
+    void select_water(terrain_selection& selection, const glm::vec3& camera_position, const frustum* frustum = nullptr) const noexcept;
+
+    size_t get_max_patch_count() const noexcept;
+    int32_t get_lod_count() const noexcept;
+    // Number of levels whose coarsest chunk covers the whole height map
+    static int32_t calculate_lod_count(int32_t width, int32_t depth) noexcept;
+    // Largest height difference between the full resolution surface and the surface of the level, lod is in [0, get_lod_count()]
+    float get_lod_error(int32_t lod) const noexcept;
+    // Min (x) and max (y) heights of the chunk of the level containing texel (x, z)
+    glm::vec2 get_chunk_bounds(int32_t x, int32_t z, int32_t lod) const noexcept;
+
+    // Creates the index buffer of the patch grid, see grid_ibo
+    static void create_grid(vertex_array& vao, buffer& ibo) noexcept;
+
 private:
-    std::vector<uint32_t> _generate_mesh_indices(int32_t width, int32_t depth) const noexcept;
-    void _calculate_normals(std::vector<mesh::vertex>& vertices, const std::vector<std::uint32_t>& indices) noexcept;
+    struct selection_context {
+        const std::vector<float>& ranges;
+        const frustum* view_frustum;
+        bool is_water;
+    };
+
+    void _load(const std::string_view height_map_path, int32_t raw_width, thread_pool* pool, bool create_height_texture) noexcept;
+    void _load_image(const std::string_view height_map_path, thread_pool* pool, bool create_height_texture) noexcept;
+    void _load_raw(const std::string_view height_map_path, int32_t raw_width, thread_pool* pool, bool create_height_texture) noexcept;
+    template <typename T>
+    void _decode_heights(const T* samples, float scale, thread_pool* pool) noexcept;
+    void _calculate_height_range(thread_pool* pool) noexcept;
+    void _create_height_texture(GLenum internal_format, GLenum type, const void* samples, const glm::vec2& range) noexcept;
+    void _create_normal_map(thread_pool* pool) noexcept;
+    void _calculate_lod_errors(thread_pool* pool) noexcept;
+    void _calculate_chunk_bounds(thread_pool* pool) noexcept;
+    void _calculate_morph_ranges(terrain_selection& selection, const std::vector<float>& ranges) const noexcept;
+    bool _select_chunk(terrain_selection& selection, int32_t x, int32_t z, int32_t lod, const selection_context& context) const noexcept;
+    void _add_patch(terrain_selection& selection, int32_t x, int32_t z, int32_t lod) const noexcept;
     bool _belongs_terrain(float local_x, float local_z) const noexcept;
 
 public:
@@ -28,14 +138,36 @@ public:
         float high = 0.0f;
     };
 
-    mesh ground_mesh;
-    mesh water_mesh;
-    std::vector<float> heights;
+    // NOTE: indices of grid of PATCH_SIZE quads shared by ground and water patches, vertex i is at (i % (PATCH_SIZE + 1), i / (PATCH_SIZE + 1)).
+    // Rows are triangle strips separated by 0xFFFF primitive restart index. Vertices have no attributes
+    vertex_array grid_vao;
+    buffer grid_ibo;
+    // NOTE: R8 or R16 normalized heights, height_texture_range holds heights of 0 and 1 texel values
+    texture_2d height_texture;
+    glm::vec2 height_texture_range = glm::vec2(0.0f, 1.0f);
+    // NOTE: RG8_SNORM full resolution local space normals, x and z only
+    texture_2d normal_texture;
     std::vector<tile> tiles;
 
     int32_t width = 0;
     int32_t depth = 0;
+    float dudv = 1.0f;
+    float water_height = 0.0f;
 
     float min_height = std::numeric_limits<float>::max();
     float max_height = std::numeric_limits<float>::min();
-};
\ No newline at end of file
+
+private:
+    // NOTE: heights are read through m_float_samples or m_r16_samples (heights are samples * HEIGHT_16_BIT_SCALE).
+    // They point into m_decoded_heights for images and into m_height_file for raw maps, so raw maps take no memory but their mapping
+    std::vector<float> m_decoded_heights;
+    mapped_file m_height_file;
+    const float* m_float_samples = nullptr;
+    const uint16_t* m_r16_samples = nullptr;
+
+    // NOTE: the largest height difference between the full resolution surface and the surface of each LOD level
+    std::vector<float> m_lod_errors;
+    // NOTE: min (x) and max (y) heights of every chunk, row-major grid of chunks per level, parents are merged from children
+    std::vector<std::vector<glm::vec2>> m_chunk_bounds;
+    int32_t m_lod_count = 0;
+};
@@ -0,0 +1,346 @@
+#include "terrain_clipmap.hpp"
+
+#include "debug.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+    int32_t floor_to_multiple(float value, int32_t step) noexcept {
+        return static_cast<int32_t>(std::floor(value / step)) * step;
+    }
+
+    int32_t positive_mod(int32_t value, int32_t divisor) noexcept {
+        return ((value % divisor) + divisor) % divisor;
+    }
+}
+
+terrain_clipmap::terrain_clipmap(const terrain& source, int32_t level_count, int32_t size) {
+    create(source, level_count, size);
+}
+
+void terrain_clipmap::create(const terrain& source, int32_t level_count, int32_t size) noexcept {
+    ASSERT(size >= 7 && ((size + 1) & size) == 0, "terrain_clipmap", "size must be 2^k - 1");
+    ASSERT(level_count > 0 && level_count <= terrain::MAX_LOD_COUNT, "terrain_clipmap", "level_count is out of range");
+    ASSERT(source.width > 0 && source.depth > 0 && source.has_heights(), "terrain_clipmap", "source terrain has no heights");
+
+    m_source = &source;
+    m_size = size;
+    m_level_count = level_count;
+
+    m_level_origins.assign(level_count, glm::ivec2(0));
+    m_is_level_valid.assign(level_count, false);
+    m_pieces.clear();
+    m_pieces.reserve(get_max_patch_count());
+
+    m_clipmap_texture.create(size, size, level_count, GL_R16);
+    m_clipmap_texture.set_parameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    m_clipmap_texture.set_parameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // NOTE: toroidal addressing, repeat wrap takes texel coordinates modulo size
+    m_clipmap_texture.set_parameter(GL_TEXTURE_WRAP_S, GL_REPEAT);
+    m_clipmap_texture.set_parameter(GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    _create_pieces();
+    _filter_levels();
+}
+
+void terrain_clipmap::destroy() noexcept {
+    if (m_clipmap_texture.get_id() != 0) {
+        m_clipmap_texture.destroy();
+    }
+    m_pieces_ibo.destroy();
+    m_pieces_vao.destroy();
+
+    m_level_origins.clear();
+    m_is_level_valid.clear();
+    m_pieces.clear();
+    m_upload_buffer.clear();
+    m_filtered_levels.clear();
+    m_level_sizes.clear();
+    m_uploaded_texel_count = 0;
+
+    m_source = nullptr;
+    m_size = 0;
+    m_level_count = 0;
+}
+
+void terrain_clipmap::update(const glm::vec3& camera_position) noexcept {
+    if (m_source == nullptr) {
+        return;
+    }
+
+    m_uploaded_texel_count = 0;
+
+    const int32_t block_size = (m_size + 1) / 4 - 1;
+    const int32_t half_size = (m_size - 1) / 2;
+
+    // NOTE: levels are centered on the camera at even multiples of their spacing, so that their edges lie on the next level grid.
+    // Every level must stay in the hole of the next one, which it may leave by one quad of the next level at most
+    for (int32_t level = m_level_count - 1; level >= 0; --level) {
+        const int32_t spacing = 1 << level;
+
+        glm::ivec2 origin(
+            floor_to_multiple(camera_position.x - half_size * spacing, 2 * spacing),
+            floor_to_multiple(camera_position.z - half_size * spacing, 2 * spacing)
+        );
+
+        if (level + 1 < m_level_count) {
+            const glm::ivec2 hole_min = m_level_origins[level + 1] + block_size * 2 * spacing;
+            origin = glm::clamp(origin, hole_min, hole_min + 2 * spacing);
+        }
+
+        if (!m_is_level_valid[level] || origin != m_level_origins[level]) {
+            _upload_level(level, origin);
+        }
+    }
+
+    _place_pieces();
+}
+
+void terrain_clipmap::select(terrain_selection& selection, const frustum* frustum) const noexcept {
+    selection.m_patches.clear();
+
+    // NOTE: patches are grouped by piece type, renderer draws every group with its own piece mesh
+    for (int32_t type = 0; type < PIECE_TYPE_COUNT; ++type) {
+        const piece_mesh& mesh = m_piece_meshes[type];
+
+        for (const piece& piece : m_pieces) {
+            if (piece.type != type) {
+                continue;
+            }
+
+            const int32_t spacing = 1 << piece.level;
+            const glm::vec3 min(piece.origin.x, m_source->min_height, piece.origin.y);
+            const glm::vec3 max(piece.origin.x + mesh.quads_x * spacing, m_source->max_height, piece.origin.y + mesh.quads_z * spacing);
+
+            if (max.x <= 0.0f || max.z <= 0.0f || min.x >= m_source->width - 1 || min.z >= m_source->depth - 1) {
+                continue;
+            }
+            if (frustum != nullptr && !frustum->is_aabb_visible(min, max)) {
+                continue;
+            }
+
+            selection.m_patches.emplace_back(glm::vec4(piece.origin.x, piece.origin.y, spacing, type * terrain::MAX_LOD_COUNT + piece.level));
+        }
+    }
+}
+
+size_t terrain_clipmap::get_max_patch_count() const noexcept {
+    // NOTE: 12 blocks, 4 fix-ups and 2 trims per level, the finest level has the center piece instead of the trims
+    return 18 * m_level_count;
+}
+
+size_t terrain_clipmap::get_uploaded_texel_count() const noexcept {
+    return m_uploaded_texel_count;
+}
+
+void terrain_clipmap::_create_pieces() noexcept {
+    const int32_t block_vertex_count = (m_size + 1) / 4;
+    const int32_t block_size = block_vertex_count - 1;
+
+    m_piece_meshes[BLOCK] = { block_size, block_size };
+    m_piece_meshes[FIXUP_X] = { 2, block_size };
+    m_piece_meshes[FIXUP_Z] = { block_size, 2 };
+    m_piece_meshes[TRIM_X] = { 1, 2 * block_vertex_count };
+    m_piece_meshes[TRIM_Z] = { 2 * block_vertex_count - 1, 1 };
+    m_piece_meshes[CENTER] = { 2 * block_vertex_count, 2 * block_vertex_count };
+
+    ASSERT((2 * block_vertex_count + 1) * (2 * block_vertex_count + 1) < terrain::PRIMITIVE_RESTART_INDEX, "terrain_clipmap", 
+        "pieces don't fit into 16-bit indices");
+
+    // NOTE: pieces are strips of rows like terrain grid, vertex i of the piece is at (i % (quads_x + 1), i / (quads_x + 1))
+    std::vector<uint16_t> indices;
+    for (piece_mesh& mesh : m_piece_meshes) {
+        mesh.first_index = indices.size();
+
+        for (int32_t z = 0; z < mesh.quads_z; ++z) {
+            if (z > 0) {
+                indices.emplace_back(terrain::PRIMITIVE_RESTART_INDEX);
+            }
+
+            for (int32_t x = 0; x <= mesh.quads_x; ++x) {
+                indices.emplace_back(static_cast<uint16_t>(z * (mesh.quads_x + 1) + x));
+                indices.emplace_back(static_cast<uint16_t>((z + 1) * (mesh.quads_x + 1) + x));
+            }
+        }
+
+        mesh.index_count = indices.size() - mesh.first_index;
+    }
+
+    m_pieces_vao.create();
+    m_pieces_vao.bind();
+
+    m_pieces_ibo.create(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(indices[0]), sizeof(indices[0]), GL_STATIC_DRAW, indices.data());
+    m_pieces_ibo.bind();
+
+    m_pieces_vao.unbind();
+}
+
+void terrain_clipmap::_filter_levels() noexcept {
+    const float height_range = std::max(m_source->max_height - m_source->min_height, std::numeric_limits<float>::epsilon());
+
+    m_filtered_levels.assign(m_level_count, std::vector<uint16_t>());
+    m_level_sizes.assign(m_level_count, glm::ivec2(m_source->width, m_source->depth));
+
+    std::vector<float> finer_heights;
+    std::vector<float> heights;
+    std::vector<float> row_buffer(m_source->width);
+    std::vector<float> filtered_rows;
+
+    // NOTE: sample c of level L is centered on texel c * 2^L. It's filtered from samples 2c - 1, 2c and 2c + 1 of the finer level
+    // weighted by 1/4, 1/2 and 1/4 along each axis, so it averages its footprint. Finer samples out of the level are clamped to its edge
+    for (int32_t level = 1; level < m_level_count; ++level) {
+        const glm::ivec2 finer_size = m_level_sizes[level - 1];
+        const glm::ivec2 size = finer_size / 2 + 1;
+        m_level_sizes[level] = size;
+
+        const auto get_finer_row = [&](int32_t z) {
+            z = std::clamp(z, 0, finer_size.y - 1);
+            return level == 1 ? m_source->get_row(z, row_buffer.data()) : finer_heights.data() + size_t(z) * finer_size.x;
+        };
+
+        heights.resize(size_t(size.x) * size.y);
+        filtered_rows.resize(3 * size_t(size.x));
+        for (int32_t z = 0; z < size.y; ++z) {
+            for (int32_t k = 0; k < 3; ++k) {
+                const float* row = get_finer_row(2 * z - 1 + k);
+                float* filtered_row = filtered_rows.data() + size_t(k) * size.x;
+
+                for (int32_t x = 0; x < size.x; ++x) {
+                    const int32_t left = std::max(2 * x - 1, 0);
+                    const int32_t center = std::min(2 * x, finer_size.x - 1);
+                    const int32_t right = std::min(2 * x + 1, finer_size.x - 1);
+                    filtered_row[x] = 0.25f * row[left] + 0.5f * row[center] + 0.25f * row[right];
+                }
+            }
+
+            for (int32_t x = 0; x < size.x; ++x) {
+                heights[size_t(z) * size.x + x] = 0.25f * filtered_rows[x] + 0.5f * filtered_rows[size.x + x] + 0.25f * filtered_rows[2 * size.x + x];
+            }
+        }
+
+        std::vector<uint16_t>& samples = m_filtered_levels[level];
+        samples.resize(heights.size());
+        for (size_t i = 0; i < heights.size(); ++i) {
+            samples[i] = static_cast<uint16_t>(std::round((heights[i] - m_source->min_height) / height_range * 65535.0f));
+        }
+
+        finer_heights.swap(heights);
+    }
+}
+
+void terrain_clipmap::_place_pieces() noexcept {
+    m_pieces.clear();
+
+    const int32_t block_vertex_count = (m_size + 1) / 4;
+    const int32_t block_size = block_vertex_count - 1;
+
+    // NOTE: offsets of blocks along each axis in quads, fix-ups fill the 2 quads between the second and the third blocks
+    const int32_t block_offsets[4] = { 0, block_size, 2 * block_size + 2, 3 * block_size + 2 };
+
+    for (int32_t level = 0; level < m_level_count; ++level) {
+        const int32_t spacing = 1 << level;
+        const glm::ivec2& origin = m_level_origins[level];
+
+        for (int32_t j = 0; j < 4; ++j) {
+            for (int32_t i = 0; i < 4; ++i) {
+                if (i == 0 || i == 3 || j == 0 || j == 3) {
+                    m_pieces.emplace_back(piece{ BLOCK, level, origin + glm::ivec2(block_offsets[i], block_offsets[j]) * spacing });
+                }
+            }
+        }
+
+        m_pieces.emplace_back(piece{ FIXUP_X, level, origin + glm::ivec2(2 * block_size, 0) * spacing });
+        m_pieces.emplace_back(piece{ FIXUP_X, level, origin + glm::ivec2(2 * block_size, block_offsets[3]) * spacing });
+        m_pieces.emplace_back(piece{ FIXUP_Z, level, origin + glm::ivec2(0, 2 * block_size) * spacing });
+        m_pieces.emplace_back(piece{ FIXUP_Z, level, origin + glm::ivec2(block_offsets[3], 2 * block_size) * spacing });
+
+        const glm::ivec2 hole_min = origin + block_size * spacing;
+        if (level == 0) {
+            m_pieces.emplace_back(piece{ CENTER, level, hole_min });
+            continue;
+        }
+
+        // NOTE: the finer level covers all of the hole but one quad on the side it has moved away from
+        const glm::ivec2& finer_origin = m_level_origins[level - 1];
+        const bool is_trim_x_low = finer_origin.x != hole_min.x;
+        const bool is_trim_z_low = finer_origin.y != hole_min.y;
+
+        const int32_t trim_x = is_trim_x_low ? hole_min.x : hole_min.x + (2 * block_vertex_count - 1) * spacing;
+        const int32_t trim_z = is_trim_z_low ? hole_min.y : hole_min.y + (2 * block_vertex_count - 1) * spacing;
+
+        m_pieces.emplace_back(piece{ TRIM_X, level, glm::ivec2(trim_x, hole_min.y) });
+        m_pieces.emplace_back(piece{ TRIM_Z, level, glm::ivec2(is_trim_x_low ? hole_min.x + spacing : hole_min.x, trim_z) });
+    }
+}
+
+void terrain_clipmap::_upload_level(int32_t level, const glm::ivec2& origin) noexcept {
+    const int32_t spacing = 1 << level;
+    const glm::ivec2 first_sample = origin / spacing;
+    const glm::ivec2 previous_first_sample = m_level_origins[level] / spacing;
+    const glm::ivec2 shift = first_sample - previous_first_sample;
+
+    if (!m_is_level_valid[level] || std::abs(shift.x) >= m_size || std::abs(shift.y) >= m_size) {
+        _upload_region(level, first_sample, glm::ivec2(m_size));
+    } else {
+        // NOTE: columns the level has moved onto over all of its new rows, then rows over all of its new columns
+        if (shift.x != 0) {
+            const int32_t first_column = shift.x > 0 ? previous_first_sample.x + m_size : first_sample.x;
+            _upload_region(level, glm::ivec2(first_column, first_sample.y), glm::ivec2(std::abs(shift.x), m_size));
+        }
+        if (shift.y != 0) {
+            const int32_t first_row = shift.y > 0 ? previous_first_sample.y + m_size : first_sample.y;
+            _upload_region(level, glm::ivec2(first_sample.x, first_row), glm::ivec2(m_size, std::abs(shift.y)));
+        }
+    }
+
+    m_level_origins[level] = origin;
+    m_is_level_valid[level] = true;
+}
+
+void terrain_clipmap::_upload_region(int32_t level, const glm::ivec2& first_sample, const glm::ivec2& sample_count) noexcept {
+    const glm::ivec2 level_size = m_level_sizes[level];
+    const std::vector<uint16_t>& filtered_samples = m_filtered_levels[level];
+    const float height_range = std::max(m_source->max_height - m_source->min_height, std::numeric_limits<float>::epsilon());
+
+    // NOTE: rows of 16-bit samples aren't 4-byte aligned
+    OGL_CALL(glPixelStorei(GL_UNPACK_ALIGNMENT, 2));
+
+    // NOTE: the region wraps around the texture at most once along each axis, so it is uploaded by 4 rectangles at most
+    const glm::ivec2 first_texel(positive_mod(first_sample.x, m_size), positive_mod(first_sample.y, m_size));
+    const glm::ivec2 first_part = glm::min(sample_count, glm::ivec2(m_size) - first_texel);
+
+    for (int32_t part_z = 0; part_z < 2; ++part_z) {
+        const int32_t offset_z = part_z == 0 ? 0 : first_part.y;
+        const int32_t count_z = part_z == 0 ? first_part.y : sample_count.y - first_part.y;
+
+        for (int32_t part_x = 0; part_x < 2; ++part_x) {
+            const int32_t offset_x = part_x == 0 ? 0 : first_part.x;
+            const int32_t count_x = part_x == 0 ? first_part.x : sample_count.x - first_part.x;
+
+            if (count_x == 0 || count_z == 0) {
+                continue;
+            }
+
+            m_upload_buffer.resize(size_t(count_x) * count_z);
+            // NOTE: samples out of the terrain are clamped to its edge
+            for (int32_t j = 0; j < count_z; ++j) {
+                const int32_t z = std::clamp(first_sample.y + offset_z + j, 0, level_size.y - 1);
+
+                for (int32_t i = 0; i < count_x; ++i) {
+                    const int32_t x = std::clamp(first_sample.x + offset_x + i, 0, level_size.x - 1);
+                    m_upload_buffer[size_t(j) * count_x + i] = level == 0
+                        ? static_cast<uint16_t>(std::round((m_source->get_sample(x, z) - m_source->min_height) / height_range * 65535.0f))
+                        : filtered_samples[size_t(z) * level_size.x + x];
+                }
+            }
+
+            const glm::ivec2 texel = glm::ivec2(positive_mod(first_texel.x + offset_x, m_size), positive_mod(first_texel.y + offset_z, m_size));
+            m_clipmap_texture.subimage(level, texel.x, texel.y, count_x, count_z, GL_RED, GL_UNSIGNED_SHORT, m_upload_buffer.data());
+            m_uploaded_texel_count += m_upload_buffer.size();
+        }
+    }
+
+    OGL_CALL(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "terrain.hpp"
+#include "texture_2d_array.hpp"
+
+// Geometry clipmap terrain (Losasso, Hoppe 2004). Level L is a square grid of size x size vertices spaced 2^L texels apart centered
+// on the camera, every level but the finest one is a ring around the next finer level. Heights of coarse levels are filtered
+// from the finer level, so that they don't alias. Heights of level L are kept in layer L of
+// a texture array with toroidal addressing: sample c of the level is stored in texel c mod size, so when a level moves only
+// the rows and columns it has moved onto are uploaded. Vertices near the outer edge of a level slide onto the grid of the next
+// level, so the levels meet without cracks. Triangle count and upload cost don't depend on the terrain size.
+// Rings are drawn by instances of a few pieces (Asirvatham, Hoppe 2005): 12 blocks, 4 fix-ups between them and an L-shaped
+// trim which fills the gap left by the finer level, the finest level has a center piece instead of the trim
+class terrain_clipmap : public nocopyable {
+    friend class renderer;
+public:
+    // NOTE: size must be 2^k - 1, so that levels have an even number of quads and split into blocks of (size + 1) / 4 vertices
+    static constexpr int32_t DEFAULT_SIZE = 255;
+    // NOTE: part of the level half size vertices slide onto the next level grid over
+    static constexpr float MORPH_WIDTH_RATIO = 0.1f;
+
+public:
+    terrain_clipmap() = default;
+    terrain_clipmap(const terrain& source, int32_t level_count, int32_t size = DEFAULT_SIZE);
+
+    // Heights are read by source.get_sample(), source may be loaded by terrain::load_heights() and must outlive the clipmap
+    void create(const terrain& source, int32_t level_count, int32_t size = DEFAULT_SIZE) noexcept;
+    void destroy() noexcept;
+
+    // Moves levels to camera_position given in the terrain local space and uploads the exposed rows and columns.
+    // Must be called from the thread which owns the OpenGL context
+    void update(const glm::vec3& camera_position) noexcept;
+
+    // Chooses pieces of the levels placed by the last update(). Pieces outside of frustum are skipped, it must be built from
+    // proj_view * model to be in the local space, nullptr disables culling. Patches w keeps piece type * MAX_LOD_COUNT + level
+    void select(terrain_selection& selection, const frustum* frustum = nullptr) const noexcept;
+
+    size_t get_max_patch_count() const noexcept;
+    // Texels uploaded by the last update()
+    size_t get_uploaded_texel_count() const noexcept;
+
+private:
+    enum piece_type { BLOCK, FIXUP_X, FIXUP_Z, TRIM_X, TRIM_Z, CENTER, PIECE_TYPE_COUNT };
+
+    struct piece_mesh {
+        int32_t quads_x = 0;
+        int32_t quads_z = 0;
+        size_t first_index = 0;
+        size_t index_count = 0;
+    };
+
+    struct piece {
+        piece_type type;
+        int32_t level;
+        glm::ivec2 origin;
+    };
+
+private:
+    void _create_pieces() noexcept;
+    void _filter_levels() noexcept;
+    void _place_pieces() noexcept;
+    void _upload_level(int32_t level, const glm::ivec2& origin) noexcept;
+    void _upload_region(int32_t level, const glm::ivec2& first_sample, const glm::ivec2& sample_count) noexcept;
+
+private:
+    const terrain* m_source = nullptr;
+
+    texture_2d_array m_clipmap_texture;
+    vertex_array m_pieces_vao;
+    buffer m_pieces_ibo;
+    piece_mesh m_piece_meshes[PIECE_TYPE_COUNT] = {};
+
+    // NOTE: origins of levels in texels, invalid until the first update()
+    std::vector<glm::ivec2> m_level_origins;
+    std::vector<bool> m_is_level_valid;
+    std::vector<piece> m_pieces;
+    std::vector<uint16_t> m_upload_buffer;
+    // NOTE: samples of levels 1 and coarser prefiltered from the finer level and normalized like the texture, level 0 is read
+    // from the source. They take a third of the source samples count in total
+    std::vector<std::vector<uint16_t>> m_filtered_levels;
+    std::vector<glm::ivec2> m_level_sizes;
+    size_t m_uploaded_texel_count = 0;
+
+    int32_t m_size = 0;
+    int32_t m_level_count = 0;
+};
@@ -0,0 +1,381 @@
+#include "terrain_pyramid.hpp"
+
+#include "assert.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+    using tile_entry = terrain_pyramid::tile_entry;
+
+    constexpr int32_t TILE_QUADS = terrain_pyramid::TILE_QUADS;
+    constexpr int32_t TILE_BORDER = terrain_pyramid::TILE_BORDER;
+    constexpr int32_t TILE_SIZE = terrain_pyramid::TILE_SIZE;
+    constexpr size_t TILE_SAMPLE_COUNT = terrain_pyramid::TILE_SAMPLE_COUNT;
+
+    // Builds tiles of all levels from one pass over the rows of the height map.
+    // NOTE: level L is the grid of every 2^L-th row and column of the height map, grid samples out of the map are clamped to its edge.
+    // So row z of level L + 1 is row min(2z, edge) of level L with every other sample dropped. Rows enter level 0 one by one,
+    // a level keeps the rows of its current row of tiles only, writes the row of tiles once it's complete and passes its rows to the next level
+    class pyramid_writer : public nocopyable {
+    public:
+        pyramid_writer() = default;
+        pyramid_writer(const terrain_pyramid::header& file_header, thread_pool* pool);
+
+        void create(const terrain_pyramid::header& file_header, thread_pool* pool) noexcept;
+
+        // Streams rows of source through the levels, rows of tiles are appended to file in the order they are completed, starting at offset
+        void write_tiles(std::ofstream& file, const terrain& source, uint64_t offset) noexcept;
+
+        size_t get_tile_count() const noexcept;
+        const std::vector<tile_entry>& get_index(int32_t lod) const noexcept;
+        // Fills level_count + 1 errors, see terrain::get_lod_error()
+        void get_lod_errors(float* lod_errors) const noexcept;
+
+    private:
+        struct level {
+            glm::ivec2 tile_count;
+            // NOTE: first grid sample on or past the edge of the height map, the next ones repeat it
+            glm::ivec2 edge;
+            // NOTE: last grid sample inside the height map, errors are measured up to it
+            glm::ivec2 last_sample;
+            int32_t row_size;
+            int32_t last_row;
+
+            // NOTE: up to TILE_SIZE rows ending before next_row, grid column x is stored at x + TILE_BORDER
+            std::vector<float> rows;
+            int32_t row_count = 0;
+            int32_t next_row = -TILE_BORDER;
+            int32_t tile_row = 0;
+
+            std::vector<float> next_level_row;
+            std::vector<tile_entry> index;
+            float error = 0.0f;
+        };
+
+        void _push_row(int32_t lod, const float* row) noexcept;
+        void _write_tile_row(int32_t lod) noexcept;
+        void _merge_bounds() noexcept;
+
+    private:
+        std::vector<level> m_levels;
+        // NOTE: one row of the finest tiles
+        std::vector<uint16_t> m_samples;
+        std::vector<float> m_tile_errors;
+
+        std::ofstream* m_file = nullptr;
+        thread_pool* m_pool = nullptr;
+        uint64_t m_offset = 0;
+
+        float m_min_height = 0.0f;
+        float m_height_range = 1.0f;
+    };
+
+
+    pyramid_writer::pyramid_writer(const terrain_pyramid::header& file_header, thread_pool* pool) {
+        create(file_header, pool);
+    }
+
+    void pyramid_writer::create(const terrain_pyramid::header& file_header, thread_pool* pool) noexcept {
+        m_pool = pool;
+        m_min_height = file_header.min_height;
+        m_height_range = std::max(file_header.max_height - file_header.min_height, std::numeric_limits<float>::epsilon());
+
+        m_levels.resize(file_header.level_count);
+        for (int32_t lod = 0; lod < file_header.level_count; ++lod) {
+            level& current = m_levels[lod];
+
+            const int32_t step = 1 << lod;
+            const int32_t span = TILE_QUADS << lod;
+            const glm::ivec2 last_texel(file_header.width - 1, file_header.depth - 1);
+
+            current.tile_count = (last_texel + span - 1) / span;
+            current.edge = (last_texel + step - 1) / step;
+            current.last_sample = last_texel / step;
+            current.row_size = (current.tile_count.x - 1) * TILE_QUADS + TILE_SIZE;
+            current.last_row = (current.tile_count.y - 1) * TILE_QUADS + TILE_SIZE - 1 - TILE_BORDER;
+
+            current.rows.resize(size_t(TILE_SIZE) * current.row_size);
+            current.index.assign(size_t(current.tile_count.x) * current.tile_count.y,
+                tile_entry{ 0, std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest() });
+
+            if (lod > 0) {
+                m_levels[lod - 1].next_level_row.resize(current.row_size);
+            }
+        }
+
+        m_samples.resize(size_t(m_levels[0].tile_count.x) * TILE_SAMPLE_COUNT);
+        m_tile_errors.resize(m_levels[0].tile_count.x);
+    }
+
+    void pyramid_writer::write_tiles(std::ofstream& file, const terrain& source, uint64_t offset) noexcept {
+        m_file = &file;
+        m_offset = offset;
+
+        // NOTE: .r16 rows are decoded into the buffer, float rows are read in place
+        std::vector<float> buffer(source.width);
+        std::vector<float> row(m_levels[0].row_size);
+
+        for (int32_t z = -TILE_BORDER; z <= m_levels[0].last_row && file; ++z) {
+            const float* source_row = source.get_row(std::clamp(z, 0, source.depth - 1), buffer.data());
+            for (int32_t x = -TILE_BORDER; x < m_levels[0].row_size - TILE_BORDER; ++x) {
+                row[x + TILE_BORDER] = source_row[std::clamp(x, 0, source.width - 1)];
+            }
+
+            _push_row(0, row.data());
+        }
+
+        _merge_bounds();
+    }
+
+    size_t pyramid_writer::get_tile_count() const noexcept {
+        size_t tile_count = 0;
+        for (const level& current : m_levels) {
+            tile_count += current.index.size();
+        }
+        return tile_count;
+    }
+
+    const std::vector<tile_entry>& pyramid_writer::get_index(int32_t lod) const noexcept {
+        return m_levels[lod].index;
+    }
+
+    void pyramid_writer::get_lod_errors(float* lod_errors) const noexcept {
+        lod_errors[0] = 0.0f;
+        for (size_t lod = 0; lod < m_levels.size(); ++lod) {
+            lod_errors[lod + 1] = lod_errors[lod] + m_levels[lod].error;
+        }
+    }
+
+    void pyramid_writer::_push_row(int32_t lod, const float* row) noexcept {
+        level& current = m_levels[lod];
+
+        const int32_t z = current.next_row++;
+        memcpy(current.rows.data() + size_t(current.row_count++) * current.row_size, row, current.row_size * sizeof(float));
+
+        if (current.row_count == TILE_SIZE) {
+            _write_tile_row(lod);
+
+            // NOTE: neighbouring rows of tiles share the border rows and the edge row
+            const int32_t shared_row_count = TILE_SIZE - TILE_QUADS;
+            memmove(current.rows.data(), current.rows.data() + size_t(TILE_QUADS) * current.row_size, size_t(shared_row_count) * current.row_size * sizeof(float));
+            current.row_count = shared_row_count;
+        }
+
+        if (lod + 1 == static_cast<int32_t>(m_levels.size())) {
+            return;
+        }
+
+        // NOTE: rows of the next level past the edge are all copies of the edge row of this level
+        level& next = m_levels[lod + 1];
+        while (next.next_row <= next.last_row && std::clamp(2 * next.next_row, 0, current.edge.y) == z) {
+            for (int32_t x = -TILE_BORDER; x < next.row_size - TILE_BORDER; ++x) {
+                current.next_level_row[x + TILE_BORDER] = row[std::clamp(2 * x, 0, current.edge.x) + TILE_BORDER];
+            }
+            _push_row(lod + 1, current.next_level_row.data());
+        }
+    }
+
+    void pyramid_writer::_write_tile_row(int32_t lod) noexcept {
+        level& current = m_levels[lod];
+
+        const int32_t tile_z = current.tile_row++;
+        const int32_t first_z = tile_z * TILE_QUADS;
+        // NOTE: the last row of grid samples belongs to the last row of tiles, samples out of the height map aren't measured
+        const int32_t error_row_count = std::min(tile_z + 1 == current.tile_count.y ? TILE_QUADS + 1 : TILE_QUADS, current.last_sample.y - first_z + 1);
+
+        parallel_for(m_pool, current.tile_count.x, 1, [&](size_t begin_tile_x, size_t end_tile_x) {
+            for (int32_t tile_x = static_cast<int32_t>(begin_tile_x); tile_x < static_cast<int32_t>(end_tile_x); ++tile_x) {
+                const int32_t first_x = tile_x * TILE_QUADS;
+                tile_entry& entry = current.index[size_t(tile_z) * current.tile_count.x + tile_x];
+
+                // NOTE: sample (i, j) of the tile is grid sample (first_x + i - TILE_BORDER, first_z + j - TILE_BORDER)
+                const float* tile_rows = current.rows.data() + first_x;
+                const auto height = [&](int32_t i, int32_t j) {
+                    return tile_rows[size_t(j) * current.row_size + i];
+                };
+
+                uint16_t* tile_samples = m_samples.data() + size_t(tile_x) * TILE_SAMPLE_COUNT;
+                for (int32_t j = 0; j < TILE_SIZE; ++j) {
+                    for (int32_t i = 0; i < TILE_SIZE; ++i) {
+                        tile_samples[j * TILE_SIZE + i] = static_cast<uint16_t>(std::round((height(i, j) - m_min_height) / m_height_range * 65535.0f));
+                    }
+                }
+
+                // NOTE: bounds of the finest tiles are taken from the full resolution samples, coarser tiles merge them afterwards
+                if (lod == 0) {
+                    for (int32_t j = TILE_BORDER; j <= TILE_BORDER + TILE_QUADS; ++j) {
+                        for (int32_t i = TILE_BORDER; i <= TILE_BORDER + TILE_QUADS; ++i) {
+                            entry.min_height = std::min(entry.min_height, height(i, j));
+                            entry.max_height = std::max(entry.max_height, height(i, j));
+                        }
+                    }
+                }
+
+                // NOTE: samples of this level dropped by the next one are compared with the interpolation of their kept neighbours
+                // the same way terrain::_calculate_lod_errors() does
+                const int32_t error_column_count = std::min(tile_x + 1 == current.tile_count.x ? TILE_QUADS + 1 : TILE_QUADS, current.last_sample.x - first_x + 1);
+
+                float error = 0.0f;
+                for (int32_t j = TILE_BORDER; j < TILE_BORDER + error_row_count; ++j) {
+                    for (int32_t i = TILE_BORDER; i < TILE_BORDER + error_column_count; ++i) {
+                        const bool is_odd_x = (first_x + i - TILE_BORDER) % 2 != 0;
+                        const bool is_odd_z = (first_z + j - TILE_BORDER) % 2 != 0;
+
+                        float interpolated_height;
+                        if (is_odd_x && is_odd_z) {
+                            interpolated_height = 0.25f * (height(i - 1, j - 1) + height(i + 1, j - 1) + height(i - 1, j + 1) + height(i + 1, j + 1));
+                        } else if (is_odd_x) {
+                            interpolated_height = 0.5f * (height(i - 1, j) + height(i + 1, j));
+                        } else if (is_odd_z) {
+                            interpolated_height = 0.5f * (height(i, j - 1) + height(i, j + 1));
+                        } else {
+                            continue;
+                        }
+
+                        error = std::max(error, std::abs(height(i, j) - interpolated_height));
+                    }
+                }
+                m_tile_errors[tile_x] = error;
+
+                entry.offset = m_offset + size_t(tile_x) * TILE_SAMPLE_COUNT * sizeof(uint16_t);
+            }
+        });
+
+        current.error = std::max(current.error, *std::max_element(m_tile_errors.begin(), m_tile_errors.begin() + current.tile_count.x));
+
+        const size_t size = size_t(current.tile_count.x) * TILE_SAMPLE_COUNT * sizeof(uint16_t);
+        m_file->write(reinterpret_cast<const char*>(m_samples.data()), size);
+        m_offset += size;
+    }
+
+    void pyramid_writer::_merge_bounds() noexcept {
+        for (size_t lod = 1; lod < m_levels.size(); ++lod) {
+            level& current = m_levels[lod];
+            const level& child = m_levels[lod - 1];
+
+            for (int32_t tile_z = 0; tile_z < current.tile_count.y; ++tile_z) {
+                for (int32_t tile_x = 0; tile_x < current.tile_count.x; ++tile_x) {
+                    tile_entry& entry = current.index[size_t(tile_z) * current.tile_count.x + tile_x];
+
+                    for (int32_t child_z = 2 * tile_z; child_z < std::min(2 * tile_z + 2, child.tile_count.y); ++child_z) {
+                        for (int32_t child_x = 2 * tile_x; child_x < std::min(2 * tile_x + 2, child.tile_count.x); ++child_x) {
+                            const tile_entry& child_entry = child.index[size_t(child_z) * child.tile_count.x + child_x];
+                            entry.min_height = std::min(entry.min_height, child_entry.min_height);
+                            entry.max_height = std::max(entry.max_height, child_entry.max_height);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+terrain_pyramid::terrain_pyramid(const std::string& filepath) {
+    open(filepath);
+}
+
+void terrain_pyramid::open(const std::string& filepath) noexcept {
+    close();
+
+    m_file.open(filepath, std::ios::binary);
+    ASSERT(m_file.is_open(), "terrain_pyramid", "couldn't open file \"" + filepath + "\"");
+
+    m_file.read(reinterpret_cast<char*>(&m_header), sizeof(m_header));
+    if (!m_file || m_header.magic != MAGIC || m_header.version != VERSION || m_header.tile_size != TILE_SIZE
+        || m_header.level_count <= 0 || m_header.level_count > terrain::MAX_LOD_COUNT
+    ) {
+        ASSERT(false, "terrain_pyramid", "invalid header in \"" + filepath + "\"");
+        close();
+        return;
+    }
+
+    m_tiles.resize(m_header.level_count);
+    for (int32_t lod = 0; lod < m_header.level_count; ++lod) {
+        const glm::ivec2 count = get_tile_count(lod);
+        m_tiles[lod].resize(size_t(count.x) * count.y);
+        m_file.read(reinterpret_cast<char*>(m_tiles[lod].data()), m_tiles[lod].size() * sizeof(tile_entry));
+    }
+
+    if (!m_file) {
+        ASSERT(false, "terrain_pyramid", "invalid index in \"" + filepath + "\"");
+        close();
+    }
+}
+
+void terrain_pyramid::close() noexcept {
+    m_file.close();
+    m_tiles.clear();
+    m_header = {};
+}
+
+bool terrain_pyramid::read_tile(int32_t lod, int32_t x, int32_t z, uint16_t* samples) noexcept {
+    m_file.seekg(static_cast<std::streamoff>(get_tile(lod, x, z).offset));
+    m_file.read(reinterpret_cast<char*>(samples), TILE_SAMPLE_COUNT * sizeof(uint16_t));
+
+    if (!m_file) {
+        m_file.clear();
+        return false;
+    }
+    return true;
+}
+
+bool terrain_pyramid::write(const std::string& filepath, const terrain& source, thread_pool* pool) noexcept {
+    ASSERT(source.width > 0 && source.depth > 0 && source.has_heights(), "terrain_pyramid", "source terrain has no heights");
+
+    header file_header = {};
+    file_header.magic = MAGIC;
+    file_header.version = VERSION;
+    file_header.width = source.width;
+    file_header.depth = source.depth;
+    file_header.level_count = source.get_lod_count();
+    file_header.tile_size = TILE_SIZE;
+    file_header.min_height = source.min_height;
+    file_header.max_height = source.max_height;
+
+    std::ofstream file(filepath, std::ios::binary);
+    ASSERT(file.is_open(), "terrain_pyramid", "couldn't create file \"" + filepath + "\"");
+
+    pyramid_writer writer(file_header, pool);
+
+    // NOTE: the header and the index are written once all tiles are built, their place is reserved
+    std::vector<char> reserved(sizeof(file_header) + writer.get_tile_count() * sizeof(tile_entry), 0);
+    file.write(reserved.data(), reserved.size());
+
+    writer.write_tiles(file, source, reserved.size());
+    writer.get_lod_errors(file_header.lod_errors);
+
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&file_header), sizeof(file_header));
+    for (int32_t lod = 0; lod < file_header.level_count && file; ++lod) {
+        const std::vector<tile_entry>& index = writer.get_index(lod);
+        file.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(tile_entry));
+    }
+
+    ASSERT(file.good(), "terrain_pyramid", "couldn't write file \"" + filepath + "\"");
+    return file.good();
+}
+
+const terrain_pyramid::header& terrain_pyramid::get_header() const noexcept {
+    return m_header;
+}
+
+const terrain_pyramid::tile_entry& terrain_pyramid::get_tile(int32_t lod, int32_t x, int32_t z) const noexcept {
+    ASSERT(lod >= 0 && lod < m_header.level_count, "terrain_pyramid", "lod is out of range");
+    return m_tiles[lod][size_t(z) * get_tile_count(lod).x + x];
+}
+
+glm::ivec2 terrain_pyramid::get_tile_count(int32_t lod) const noexcept {
+    return _get_tile_count(m_header.width, m_header.depth, lod);
+}
+
+bool terrain_pyramid::is_valid() const noexcept {
+    return !m_tiles.empty();
+}
+
+glm::ivec2 terrain_pyramid::_get_tile_count(int32_t width, int32_t depth, int32_t lod) noexcept {
+    const int32_t span = TILE_QUADS << lod;
+    return glm::ivec2((width - 1 + span - 1) / span, (depth - 1 + span - 1) / span);
+}
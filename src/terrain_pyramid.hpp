@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "terrain.hpp"
+#include "thread_pool.hpp"
+
+// On-disk tile pyramid of a height map for terrain_streamer, made by the terrain_pyramid tool. Tile of level L is the terrain chunk 
+// of level L: it keeps every 2^L-th sample of TILE_QUADS << L texels plus TILE_BORDER samples on each side for normals,
+// samples out of the height map are clamped to its edge.
+// Layout: header, index of tile entries of every level (row-major), samples of tiles as little-endian uint16 normalized to
+// [min_height, max_height] of the header. Tiles are stored in the order they're built, tile_entry::offset locates them
+class terrain_pyramid : public nocopyable {
+public:
+    static constexpr uint32_t MAGIC = 0x52595054; // "TPYR"
+    static constexpr uint32_t VERSION = 1;
+
+    static constexpr int32_t TILE_QUADS = terrain::CHUNK_SIZE;
+    static constexpr int32_t TILE_BORDER = 1;
+    static constexpr int32_t TILE_SIZE = TILE_QUADS + 1 + 2 * TILE_BORDER;
+    static constexpr size_t TILE_SAMPLE_COUNT = TILE_SIZE * TILE_SIZE;
+
+    struct header {
+        uint32_t magic;
+        uint32_t version;
+        int32_t width;
+        int32_t depth;
+        int32_t level_count;
+        int32_t tile_size;
+        float min_height;
+        float max_height;
+        // NOTE: see terrain::get_lod_error()
+        float lod_errors[terrain::MAX_LOD_COUNT + 1];
+    };
+
+    struct tile_entry {
+        uint64_t offset;
+        // NOTE: bounds of the full resolution heights covered by the tile
+        float min_height;
+        float max_height;
+    };
+
+public:
+    terrain_pyramid() = default;
+    terrain_pyramid(const std::string& filepath);
+
+    // Reads the header and the index, tiles are read by read_tile()
+    void open(const std::string& filepath) noexcept;
+    void close() noexcept;
+
+    // Reads TILE_SAMPLE_COUNT samples of tile (x, z) of the level. Must not be called from several threads at once
+    bool read_tile(int32_t lod, int32_t x, int32_t z, uint16_t* samples) noexcept;
+
+    // Builds the pyramid of the heights loaded by terrain::load_samples() in one pass over its rows, coarser levels are built from
+    // the finer ones along with the tile bounds and LOD errors. Memory is bounded by a row of tiles per level (.r16 and .f32 maps
+    // are read from their mapping). Tiles of a row are built by the pool workers
+    static bool write(const std::string& filepath, const terrain& source, thread_pool* pool = nullptr) noexcept;
+
+    const header& get_header() const noexcept;
+    const tile_entry& get_tile(int32_t lod, int32_t x, int32_t z) const noexcept;
+    glm::ivec2 get_tile_count(int32_t lod) const noexcept;
+
+    bool is_valid() const noexcept;
+
+private:
+    static glm::ivec2 _get_tile_count(int32_t width, int32_t depth, int32_t lod) noexcept;
+
+private:
+    header m_header = {};
+    std::vector<std::vector<tile_entry>> m_tiles;
+    std::ifstream m_file;
+};
@@ -0,0 +1,347 @@
+#include "terrain_streamer.hpp"
+
+#include "debug.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#include <glm/gtx/norm.hpp>
+
+namespace {
+    bool is_aabb_in_sphere_range(const glm::vec3& min, const glm::vec3& max, const glm::vec3& center, float radius) noexcept {
+        const glm::vec3 closest = glm::clamp(center, min, max);
+        return glm::length2(closest - center) <= radius * radius;
+    }
+}
+
+terrain_streamer::terrain_streamer(const std::string& pyramid_path, size_t memory_budget, float dudv) {
+    create(pyramid_path, memory_budget, dudv);
+}
+
+terrain_streamer::~terrain_streamer() {
+    destroy();
+}
+
+void terrain_streamer::create(const std::string& pyramid_path, size_t memory_budget, float dudv) noexcept {
+    destroy();
+
+    ASSERT(dudv > 0.0f, "terrain_streamer", "dudv must be greater than zero");
+    m_dudv = dudv;
+
+    m_pyramid.open(pyramid_path);
+    if (!m_pyramid.is_valid()) {
+        return;
+    }
+
+    int32_t max_layer_count = 0;
+    OGL_CALL(glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layer_count));
+
+    size_t slot_count = memory_budget / (terrain_pyramid::TILE_SAMPLE_COUNT * sizeof(uint16_t));
+    if (slot_count > size_t(max_layer_count)) {
+        LOG_WARN("terrain_streamer", "memory budget is limited to " + std::to_string(max_layer_count) + " tiles");
+        slot_count = max_layer_count;
+    }
+    // NOTE: the root tile and its children must fit at least
+    ASSERT(slot_count >= 5, "terrain_streamer", "memory budget is too small");
+
+    m_slots.assign(slot_count, slot{ INVALID_KEY, 0 });
+
+    m_tiles_texture.create(terrain_pyramid::TILE_SIZE, terrain_pyramid::TILE_SIZE, slot_count, GL_R16);
+    m_tiles_texture.set_parameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    m_tiles_texture.set_parameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    m_tiles_texture.set_parameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    m_tiles_texture.set_parameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    terrain::create_grid(m_grid_vao, m_grid_ibo);
+
+    m_is_stopped = false;
+    m_loader = std::thread(&terrain_streamer::_loader_loop, this);
+}
+
+void terrain_streamer::destroy() noexcept {
+    if (m_loader.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_is_stopped = true;
+        }
+        m_condition.notify_all();
+        m_loader.join();
+    }
+
+    m_requests.clear();
+    m_loaded_tiles.clear();
+    m_loading_key = INVALID_KEY;
+
+    if (m_tiles_texture.get_id() != 0) {
+        m_tiles_texture.destroy();
+    }
+    m_grid_ibo.destroy();
+    m_grid_vao.destroy();
+
+    m_slots.clear();
+    m_resident_tiles.clear();
+    m_ranges.clear();
+    m_frame = 0;
+
+    m_pyramid.close();
+}
+
+void terrain_streamer::update(const glm::vec3& camera_position, float projection_scale, float max_pixel_error) noexcept {
+    ASSERT(max_pixel_error > 0.0f, "terrain_streamer", "max_pixel_error must be greater than zero");
+
+    if (!m_pyramid.is_valid()) {
+        return;
+    }
+
+    ++m_frame;
+
+    // NOTE: the same ranges as terrain::select() chooses
+    const terrain_pyramid::header& header = m_pyramid.get_header();
+    const float error_to_distance = projection_scale / max_pixel_error;
+
+    m_ranges.resize(header.level_count);
+    for (int32_t lod = 0; lod < header.level_count; ++lod) {
+        const float min_range = lod == 0 ? 2.0f * terrain::CHUNK_SIZE : 2.0f * m_ranges[lod - 1];
+        m_ranges[lod] = std::max(header.lod_errors[lod + 1] * error_to_distance, min_range);
+    }
+    m_ranges.back() = std::numeric_limits<float>::max();
+
+    std::vector<tile_request> requests;
+    _request_tile(header.level_count - 1, 0, 0, camera_position, requests);
+
+    _upload_loaded_tiles();
+
+    // NOTE: tiles used by this frame aren't evicted, so there is no point in loading more tiles than the other slots can keep
+    const size_t used_count = std::count_if(m_slots.begin(), m_slots.end(), [this](const slot& slot) {
+        return slot.last_used_frame == m_frame;
+    });
+    const size_t max_request_count = m_slots.size() - used_count;
+
+    std::sort(requests.begin(), requests.end(), [](const tile_request& a, const tile_request& b) {
+        return a.lod < b.lod || (a.lod == b.lod && a.distance > b.distance);
+    });
+    if (requests.size() > max_request_count) {
+        requests.erase(requests.begin(), requests.end() - max_request_count);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // NOTE: tiles which are loaded already or are being loaded aren't requested again
+        requests.erase(std::remove_if(requests.begin(), requests.end(), [this](const tile_request& request) {
+            return request.key == m_loading_key || m_resident_tiles.find(request.key) != m_resident_tiles.end() ||
+                std::any_of(m_loaded_tiles.begin(), m_loaded_tiles.end(), [&request](const loaded_tile& tile) { return tile.key == request.key; });
+        }), requests.end());
+
+        m_requests = std::move(requests);
+    }
+    m_condition.notify_one();
+}
+
+void terrain_streamer::select(terrain_selection& selection, const glm::vec3& camera_position, const frustum* frustum) const noexcept {
+    selection.m_patches.clear();
+    selection.m_camera_position = camera_position;
+
+    if (m_ranges.empty()) {
+        return;
+    }
+
+    selection.m_morph_ranges.resize(m_ranges.size());
+    for (size_t lod = 0; lod < m_ranges.size(); ++lod) {
+        const float range_start = lod == 0 ? 0.0f : m_ranges[lod - 1];
+        selection.m_morph_ranges[lod] = glm::vec2(range_start + (m_ranges[lod] - range_start) * terrain::MORPH_START_RATIO, m_ranges[lod]);
+    }
+    selection.m_morph_ranges.back() = glm::vec2(std::numeric_limits<float>::max());
+
+    _select_tile(selection, static_cast<int32_t>(m_ranges.size()) - 1, 0, 0, frustum);
+}
+
+size_t terrain_streamer::get_max_patch_count() const noexcept {
+    // NOTE: only loaded tiles are drawn, each of them by 4 patches at most
+    return 4 * m_slots.size();
+}
+
+size_t terrain_streamer::get_resident_tile_count() const noexcept {
+    return m_resident_tiles.size();
+}
+
+const terrain_pyramid::header& terrain_streamer::get_header() const noexcept {
+    return m_pyramid.get_header();
+}
+
+uint64_t terrain_streamer::_make_key(int32_t lod, int32_t x, int32_t z) noexcept {
+    return (uint64_t(lod) << 48) | (uint64_t(z) << 24) | uint64_t(x);
+}
+
+glm::ivec3 terrain_streamer::_split_key(uint64_t key) noexcept {
+    return glm::ivec3(key >> 48, key & 0xFFFFFF, (key >> 24) & 0xFFFFFF);
+}
+
+void terrain_streamer::_loader_loop() noexcept {
+    while (true) {
+        tile_request request;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_is_stopped || !m_requests.empty(); });
+
+            if (m_is_stopped) {
+                return;
+            }
+
+            request = m_requests.back();
+            m_requests.pop_back();
+            m_loading_key = request.key;
+        }
+
+        loaded_tile tile{ request.key, std::vector<uint16_t>(terrain_pyramid::TILE_SAMPLE_COUNT) };
+
+        const glm::ivec3 tile_coord = _split_key(request.key);
+        const bool is_read = m_pyramid.read_tile(tile_coord.x, tile_coord.y, tile_coord.z, tile.samples.data());
+        if (!is_read) {
+            LOG_WARN("terrain_streamer", "couldn't read tile " + std::to_string(tile_coord.y) + ", " + std::to_string(tile_coord.z) + 
+                " of level " + std::to_string(tile_coord.x));
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_loading_key = INVALID_KEY;
+        if (is_read) {
+            m_loaded_tiles.emplace_back(std::move(tile));
+        }
+    }
+}
+
+void terrain_streamer::_request_tile(int32_t lod, int32_t x, int32_t z, const glm::vec3& camera_position, std::vector<tile_request>& requests) noexcept {
+    glm::vec3 min, max;
+    if (!_get_tile_aabb(lod, x, z, min, max)) {
+        return;
+    }
+
+    const uint64_t key = _make_key(lod, x, z);
+    const int32_t slot = _find_slot(key);
+    if (slot >= 0) {
+        m_slots[slot].last_used_frame = m_frame;
+    } else {
+        requests.emplace_back(tile_request{ key, lod, glm::distance(glm::clamp(camera_position, min, max), camera_position) });
+    }
+
+    // NOTE: children are requested along with their parent, the parent is loaded first anyway
+    if (lod == 0 || !is_aabb_in_sphere_range(min, max, camera_position, m_ranges[lod - 1] * PREFETCH_RANGE_SCALE)) {
+        return;
+    }
+
+    for (int32_t quadrant = 0; quadrant < 4; ++quadrant) {
+        _request_tile(lod - 1, 2 * x + quadrant % 2, 2 * z + quadrant / 2, camera_position, requests);
+    }
+}
+
+void terrain_streamer::_upload_loaded_tiles() noexcept {
+    std::vector<loaded_tile> loaded_tiles;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        loaded_tiles.swap(m_loaded_tiles);
+    }
+
+    // NOTE: rows of TILE_SIZE 16-bit samples aren't 4-byte aligned
+    OGL_CALL(glPixelStorei(GL_UNPACK_ALIGNMENT, 2));
+
+    for (const loaded_tile& tile : loaded_tiles) {
+        if (m_resident_tiles.find(tile.key) != m_resident_tiles.end()) {
+            continue;
+        }
+
+        // NOTE: the least recently used slot which isn't used by this frame, free slots have never been used
+        int32_t slot_index = -1;
+        uint64_t oldest_frame = m_frame;
+        for (size_t i = 0; i < m_slots.size(); ++i) {
+            if (m_slots[i].last_used_frame < oldest_frame) {
+                oldest_frame = m_slots[i].last_used_frame;
+                slot_index = static_cast<int32_t>(i);
+            }
+        }
+
+        if (slot_index < 0) {
+            continue;
+        }
+
+        slot& slot = m_slots[slot_index];
+        if (slot.key != INVALID_KEY) {
+            m_resident_tiles.erase(slot.key);
+        }
+
+        m_tiles_texture.subimage(slot_index, terrain_pyramid::TILE_SIZE, terrain_pyramid::TILE_SIZE, GL_RED, GL_UNSIGNED_SHORT, tile.samples.data());
+
+        slot.key = tile.key;
+        slot.last_used_frame = m_frame;
+        m_resident_tiles.emplace(tile.key, slot_index);
+    }
+
+    OGL_CALL(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+}
+
+bool terrain_streamer::_select_tile(terrain_selection& selection, int32_t lod, int32_t x, int32_t z, const frustum* frustum) const noexcept {
+    glm::vec3 min, max;
+    if (!_get_tile_aabb(lod, x, z, min, max)) {
+        return true;
+    }
+
+    if (!is_aabb_in_sphere_range(min, max, selection.m_camera_position, m_ranges[lod])) {
+        return false;
+    }
+
+    // NOTE: tile which isn't loaded yet is drawn by its parent
+    const int32_t slot = _find_slot(_make_key(lod, x, z));
+    if (slot < 0) {
+        return false;
+    }
+
+    if (frustum != nullptr && !frustum->is_aabb_visible(min, max)) {
+        return true;
+    }
+
+    const terrain_pyramid::header& header = m_pyramid.get_header();
+    const int32_t half_span = (terrain_pyramid::TILE_QUADS << lod) / 2;
+
+    // NOTE: patches keep the slot of their tile along with the LOD level in w: slot * MAX_LOD_COUNT + lod
+    const auto add_patch = [&](int32_t quadrant) {
+        const int32_t patch_x = static_cast<int32_t>(min.x) + (quadrant % 2) * half_span;
+        const int32_t patch_z = static_cast<int32_t>(min.z) + (quadrant / 2) * half_span;
+        if (patch_x < header.width - 1 && patch_z < header.depth - 1) {
+            selection.m_patches.emplace_back(glm::vec4(patch_x, patch_z, 1 << lod, slot * terrain::MAX_LOD_COUNT + lod));
+        }
+    };
+
+    if (lod == 0 || !is_aabb_in_sphere_range(min, max, selection.m_camera_position, m_ranges[lod - 1])) {
+        for (int32_t quadrant = 0; quadrant < 4; ++quadrant) {
+            add_patch(quadrant);
+        }
+        return true;
+    }
+
+    for (int32_t quadrant = 0; quadrant < 4; ++quadrant) {
+        if (!_select_tile(selection, lod - 1, 2 * x + quadrant % 2, 2 * z + quadrant / 2, frustum)) {
+            add_patch(quadrant);
+        }
+    }
+
+    return true;
+}
+
+bool terrain_streamer::_get_tile_aabb(int32_t lod, int32_t x, int32_t z, glm::vec3& min, glm::vec3& max) const noexcept {
+    const glm::ivec2 tile_count = m_pyramid.get_tile_count(lod);
+    if (x >= tile_count.x || z >= tile_count.y) {
+        return false;
+    }
+
+    const terrain_pyramid::header& header = m_pyramid.get_header();
+    const terrain_pyramid::tile_entry& tile = m_pyramid.get_tile(lod, x, z);
+    const int32_t span = terrain_pyramid::TILE_QUADS << lod;
+
+    min = glm::vec3(x * span, tile.min_height, z * span);
+    max = glm::vec3(std::min((x + 1) * span, header.width - 1), tile.max_height, std::min((z + 1) * span, header.depth - 1));
+    return true;
+}
+
+int32_t terrain_streamer::_find_slot(uint64_t key) const noexcept {
+    const auto it = m_resident_tiles.find(key);
+    return it != m_resident_tiles.end() ? it->second : -1;
+}
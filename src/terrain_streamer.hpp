@@ -0,0 +1,98 @@
+#pragma once
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "terrain.hpp"
+#include "terrain_pyramid.hpp"
+#include "texture_2d_array.hpp"
+
+// Terrain which doesn't fit in memory, drawn from terrain_pyramid tiles streamed around the camera. Tile of level L is drawn as
+// the terrain chunk of level L, tiles whose children aren't loaded yet draw their quadrants themselves.
+// Tiles are read by the loader thread, the coarsest and the closest first, and are kept in layers of a texture array.
+// When memory_budget is exhausted the least recently used tiles are evicted, tiles used by the current frame are never evicted
+class terrain_streamer : public nocopyable {
+    friend class renderer;
+public:
+    // NOTE: tiles are prefetched this much farther than they are drawn
+    static constexpr float PREFETCH_RANGE_SCALE = 1.25f;
+
+public:
+    terrain_streamer() = default;
+    terrain_streamer(const std::string& pyramid_path, size_t memory_budget, float dudv);
+    ~terrain_streamer();
+
+    void create(const std::string& pyramid_path, size_t memory_budget, float dudv) noexcept;
+    void destroy() noexcept;
+
+    // Uploads the tiles loaded since the last call and requests the missing tiles around camera_position given in the terrain local space.
+    // LOD ranges are chosen like terrain::select() does. Must be called once per frame from the thread which owns the OpenGL context
+    void update(const glm::vec3& camera_position, float projection_scale, float max_pixel_error = 2.0f) noexcept;
+
+    // Same as terrain::select() over the loaded tiles with the ranges of the last update()
+    void select(terrain_selection& selection, const glm::vec3& camera_position, const frustum* frustum = nullptr) const noexcept;
+
+    size_t get_max_patch_count() const noexcept;
+    size_t get_resident_tile_count() const noexcept;
+    const terrain_pyramid::header& get_header() const noexcept;
+
+private:
+    struct tile_request {
+        uint64_t key;
+        int32_t lod;
+        float distance;
+    };
+
+    struct loaded_tile {
+        uint64_t key;
+        std::vector<uint16_t> samples;
+    };
+
+    struct slot {
+        uint64_t key;
+        uint64_t last_used_frame;
+    };
+
+private:
+    static uint64_t _make_key(int32_t lod, int32_t x, int32_t z) noexcept;
+    static glm::ivec3 _split_key(uint64_t key) noexcept;
+
+    void _loader_loop() noexcept;
+
+    void _request_tile(int32_t lod, int32_t x, int32_t z, const glm::vec3& camera_position, std::vector<tile_request>& requests) noexcept;
+    void _upload_loaded_tiles() noexcept;
+    bool _select_tile(terrain_selection& selection, int32_t lod, int32_t x, int32_t z, const frustum* frustum) const noexcept;
+
+    bool _get_tile_aabb(int32_t lod, int32_t x, int32_t z, glm::vec3& min, glm::vec3& max) const noexcept;
+    int32_t _find_slot(uint64_t key) const noexcept;
+
+private:
+    static constexpr uint64_t INVALID_KEY = ~0ull;
+
+    terrain_pyramid m_pyramid;
+
+    // NOTE: layer i keeps the tile of slot i
+    texture_2d_array m_tiles_texture;
+    vertex_array m_grid_vao;
+    buffer m_grid_ibo;
+
+    std::vector<slot> m_slots;
+    std::unordered_map<uint64_t, int32_t> m_resident_tiles;
+    std::vector<float> m_ranges;
+    uint64_t m_frame = 0;
+    float m_dudv = 1.0f;
+
+    // NOTE: loader state guarded by m_mutex. Requests are sorted so that the most important one is at the back
+    std::thread m_loader;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::vector<tile_request> m_requests;
+    std::vector<loaded_tile> m_loaded_tiles;
+    uint64_t m_loading_key = INVALID_KEY;
+    bool m_is_stopped = false;
+};
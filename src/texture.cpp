@@ -15,7 +15,7 @@ texture_2d::texture_2d(const std::string &filepath, bool flip_on_load, bool use_
 }
 
 texture_2d::texture_2d(uint32_t width, uint32_t height, int32_t level, 
-    int32_t internal_format, int32_t format, int32_t type, void *pixels, variety variety
+    int32_t internal_format, int32_t format, int32_t type, const void* pixels, variety variety
 ) {
     create(width, height, level, internal_format, format, type, pixels, variety);
 }
@@ -54,7 +54,7 @@ void texture_2d::load(const std::string &filepath, bool flip_on_load, bool use_g
 }
 
 void texture_2d::create(uint32_t width, uint32_t height, int32_t level, 
-    int32_t internal_format, int32_t format, int32_t type, void* pixels, variety variety
+    int32_t internal_format, int32_t format, int32_t type, const void* pixels, variety variety
 ) noexcept {
     if (m_data.id != 0) {
         LOG_WARN("texture warning", "texture recreation (prev id = " + std::to_string(m_data.id) + ")");
@@ -12,12 +12,12 @@ public:
     texture_2d() = default;
     texture_2d(const std::string &filepath, bool flip_on_load = true, bool use_gamma = false, variety variety = variety::NONE);
     texture_2d(uint32_t width, uint32_t height, int32_t level, 
-        int32_t internal_format, int32_t format, int32_t type, void* pixels = nullptr, variety variety = variety::NONE);
+        int32_t internal_format, int32_t format, int32_t type, const void* pixels = nullptr, variety variety = variety::NONE);
     ~texture_2d();
 
     void load(const std::string &filepath, bool flip_on_load, bool use_gamma, variety variety) noexcept;
     void create(uint32_t width, uint32_t height, int32_t level, 
-        int32_t internal_format, int32_t format, int32_t type, void* pixels = nullptr, variety variety = variety::NONE) noexcept;
+        int32_t internal_format, int32_t format, int32_t type, const void* pixels = nullptr, variety variety = variety::NONE) noexcept;
     void destroy() noexcept;
 
     void generate_mipmap() const noexcept;
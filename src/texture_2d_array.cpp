@@ -0,0 +1,186 @@
+#include "texture_2d_array.hpp"
+
+#include "debug.hpp"
+
+#include <glad/glad.h>
+#include <stb/stb_image.h>
+
+#include <algorithm>
+
+texture_2d_array::texture_2d_array(uint32_t width, uint32_t height, uint32_t layer_count, uint32_t internal_format) {
+    create(width, height, layer_count, internal_format);
+}
+
+texture_2d_array::texture_2d_array(const std::vector<std::string>& layers, bool flip_on_load, bool use_gamma) {
+    load(layers, flip_on_load, use_gamma);
+}
+
+texture_2d_array::~texture_2d_array() {
+    destroy();
+}
+
+void texture_2d_array::load(const std::vector<std::string>& layers, bool flip_on_load, bool use_gamma) noexcept {
+    ASSERT(!layers.empty(), "texture_2d_array", "layers are empty");
+
+    stbi_set_flip_vertically_on_load(flip_on_load);
+
+    std::vector<uint8_t*> pixels(layers.size());
+    std::vector<glm::ivec2> sizes(layers.size());
+
+    // NOTE: all layers are forced to RGBA since they share one internal format
+    glm::ivec2 max_size(0);
+    for (size_t i = 0; i < layers.size(); ++i) {
+        int32_t channel_count = 0;
+        pixels[i] = stbi_load(layers[i].c_str(), &sizes[i].x, &sizes[i].y, &channel_count, 4);
+
+        ASSERT(pixels[i] != nullptr, "texture_2d_array", "couldn't load texture \"" + layers[i] + "\"");
+
+        max_size = glm::max(max_size, sizes[i]);
+    }
+
+    create(max_size.x, max_size.y, layers.size(), _get_gl_format(4, use_gamma));
+
+    for (size_t i = 0; i < layers.size(); ++i) {
+        subimage(i, sizes[i].x, sizes[i].y, GL_RGBA, GL_UNSIGNED_BYTE, pixels[i]);
+        stbi_image_free(pixels[i]);
+    }
+}
+
+void texture_2d_array::create(uint32_t width, uint32_t height, uint32_t layer_count, uint32_t internal_format) noexcept {
+    if (m_data.id != 0) {
+        LOG_WARN("texture_2d_array warning", "texture_2d_array recreation (prev id = " + std::to_string(m_data.id) + ")");
+        destroy();
+    }
+
+    m_data.width = width;
+    m_data.height = height;
+    m_data.layer_count = layer_count;
+
+    m_layer_uv_scales.assign(layer_count, glm::vec2(1.0f));
+
+    OGL_CALL(glGenTextures(1, &m_data.id));
+    bind();
+
+    OGL_CALL(glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, internal_format, width, height, layer_count, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+
+    // NOTE: layers smaller than the array are padded with transparent black, so filtering at their borders doesn't pick garbage
+    const uint8_t zero[4] = { 0, 0, 0, 0 };
+    OGL_CALL(glClearTexImage(m_data.id, 0, GL_RGBA, GL_UNSIGNED_BYTE, zero));
+}
+
+void texture_2d_array::destroy() noexcept {
+    OGL_CALL(glDeleteTextures(1, &m_data.id));
+    m_data.id = 0;
+    m_layer_uv_scales.clear();
+}
+
+void texture_2d_array::subimage(uint32_t layer, uint32_t width, uint32_t height, uint32_t format, uint32_t type, const void* pixels) noexcept {
+    ASSERT(layer < m_data.layer_count, "texture_2d_array", "layer is out of range");
+    ASSERT(width <= m_data.width && height <= m_data.height, "texture_2d_array", "image is bigger than the array");
+
+    bind();
+    OGL_CALL(glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1, format, type, pixels));
+
+    m_layer_uv_scales[layer] = glm::vec2(width, height) / glm::vec2(m_data.width, m_data.height);
+}
+
+void texture_2d_array::subimage(uint32_t layer, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t format, uint32_t type, const void* pixels) noexcept {
+    ASSERT(layer < m_data.layer_count, "texture_2d_array", "layer is out of range");
+    ASSERT(x + width <= m_data.width && y + height <= m_data.height, "texture_2d_array", "region is out of the array");
+
+    bind();
+    OGL_CALL(glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, x, y, layer, width, height, 1, format, type, pixels));
+}
+
+void texture_2d_array::bind(int32_t unit) const noexcept {
+#ifdef _DEBUG
+    int32_t max_units_count;
+    OGL_CALL(glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &max_units_count));
+    ASSERT(unit < max_units_count, "texture error", "unit value is greater than GL_MAX_TEXTURE_UNITS");
+#endif
+    if (unit >= 0) {
+        const_cast<texture_2d_array*>(this)->m_data.texture_unit = unit;
+        OGL_CALL(glActiveTexture(GL_TEXTURE0 + unit));
+    }
+
+    OGL_CALL(glBindTexture(GL_TEXTURE_2D_ARRAY, m_data.id));
+}
+
+void texture_2d_array::unbind() const noexcept {
+    OGL_CALL(glBindTexture(GL_TEXTURE_2D_ARRAY, 0));
+}
+
+void texture_2d_array::generate_mipmap() const noexcept {
+    bind();
+    OGL_CALL(glGenerateMipmap(GL_TEXTURE_2D_ARRAY));
+}
+
+void texture_2d_array::set_parameter(uint32_t pname, int32_t param) const noexcept {
+    bind();
+    OGL_CALL(glTexParameteri(GL_TEXTURE_2D_ARRAY, pname, param));
+}
+
+void texture_2d_array::set_parameter(uint32_t pname, float param) const noexcept {
+    bind();
+    OGL_CALL(glTexParameterf(GL_TEXTURE_2D_ARRAY, pname, param));
+}
+
+uint32_t texture_2d_array::get_id() const noexcept {
+    return m_data.id;
+}
+
+uint32_t texture_2d_array::get_unit() const noexcept {
+    return m_data.texture_unit;
+}
+
+uint32_t texture_2d_array::get_width() const noexcept {
+    return m_data.width;
+}
+
+uint32_t texture_2d_array::get_height() const noexcept {
+    return m_data.height;
+}
+
+uint32_t texture_2d_array::get_layer_count() const noexcept {
+    return m_data.layer_count;
+}
+
+const glm::vec2& texture_2d_array::get_layer_uv_scale(uint32_t layer) const noexcept {
+    ASSERT(layer < m_data.layer_count, "texture_2d_array", "layer is out of range");
+    return m_layer_uv_scales[layer];
+}
+
+texture_2d_array::texture_2d_array(texture_2d_array &&array)
+    : m_data(array.m_data), m_layer_uv_scales(std::move(array.m_layer_uv_scales))
+{
+    if (this != &array) {
+        memset(&array.m_data, 0, sizeof(array.m_data));
+    }
+}
+
+texture_2d_array &texture_2d_array::operator=(texture_2d_array &&array) noexcept {
+    if (this != &array) {
+        m_data = array.m_data;
+        m_layer_uv_scales = std::move(array.m_layer_uv_scales);
+        memset(&array.m_data, 0, sizeof(array.m_data));
+    }
+    
+    return *this;
+}
+
+int32_t texture_2d_array::_get_gl_format(int32_t channel_count, bool use_gamma) const noexcept {
+    switch (channel_count) {
+    case 1:
+        return GL_RED;
+
+    case 3:
+        return use_gamma ? GL_SRGB : GL_RGB;
+
+    case 4:
+        return use_gamma ? GL_SRGB_ALPHA : GL_RGBA;
+    
+    default:
+        ASSERT(false, "texture_2d_array", "invalid channel count");
+        return 0;
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+#include "nocopyable.hpp"
+
+class texture_2d_array : public nocopyable {
+public:
+    texture_2d_array() = default;
+    texture_2d_array(uint32_t width, uint32_t height, uint32_t layer_count, uint32_t internal_format);
+    texture_2d_array(const std::vector<std::string>& layers, bool flip_on_load = true, bool use_gamma = false);
+    ~texture_2d_array();
+
+    // Images may have different sizes, the array is allocated for the biggest one and every layer 
+    // keeps the part of [0, 1] UV range which is covered by its image (see get_layer_uv_scale())
+    void load(const std::vector<std::string>& layers, bool flip_on_load, bool use_gamma) noexcept;
+    void create(uint32_t width, uint32_t height, uint32_t layer_count, uint32_t internal_format) noexcept;
+    void destroy() noexcept;
+
+    void subimage(uint32_t layer, uint32_t width, uint32_t height, uint32_t format, uint32_t type, const void* pixels) noexcept;
+    // Updates a region of the layer, UV scale of the layer stays the same
+    void subimage(uint32_t layer, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t format, uint32_t type, const void* pixels) noexcept;
+
+    void bind(int32_t unit = -1) const noexcept;
+    void unbind() const noexcept;
+
+    void generate_mipmap() const noexcept;
+    void set_parameter(uint32_t pname, int32_t param) const noexcept;
+    void set_parameter(uint32_t pname, float param) const noexcept;
+
+    uint32_t get_id() const noexcept;
+    uint32_t get_unit() const noexcept;
+    uint32_t get_width() const noexcept;
+    uint32_t get_height() const noexcept;
+    uint32_t get_layer_count() const noexcept;
+    const glm::vec2& get_layer_uv_scale(uint32_t layer) const noexcept;
+
+    texture_2d_array(texture_2d_array&& array);
+    texture_2d_array& operator=(texture_2d_array&& array) noexcept;
+
+private:
+    int32_t _get_gl_format(int32_t channel_count, bool use_gamma) const noexcept;
+
+private:
+    struct data {
+        uint32_t id = 0;
+        
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t layer_count = 0;
+        
+        uint32_t texture_unit = 0;
+    };
+
+private:
+    data m_data;
+    std::vector<glm::vec2> m_layer_uv_scales;
+};
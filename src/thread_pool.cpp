@@ -0,0 +1,121 @@
+#include "thread_pool.hpp"
+
+#include "log.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+thread_pool::thread_pool(size_t worker_count) {
+    create(worker_count);
+}
+
+thread_pool::~thread_pool() {
+    destroy();
+}
+
+void thread_pool::create(size_t worker_count) noexcept {
+    if (!m_workers.empty()) {
+        LOG_WARN("thread_pool", "thread pool recreation (prev worker count = " + std::to_string(m_workers.size()) + ")");
+        destroy();
+    }
+
+    m_is_stopped = false;
+
+    m_workers.reserve(worker_count);
+    for (size_t i = 0; i < worker_count; ++i) {
+        m_workers.emplace_back(&thread_pool::_worker_loop, this);
+    }
+}
+
+void thread_pool::destroy() noexcept {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_is_stopped = true;
+    }
+    m_condition.notify_all();
+
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+    m_workers.clear();
+}
+
+void thread_pool::parallel_for(size_t count, size_t grain_size, const std::function<void(size_t, size_t)>& func) noexcept {
+    if (count == 0) {
+        return;
+    }
+
+    grain_size = std::max<size_t>(grain_size, 1);
+
+    const size_t max_range_count = (count + grain_size - 1) / grain_size;
+    const size_t range_count = std::min(max_range_count, m_workers.size() + 1);
+    
+    if (range_count <= 1) {
+        func(0, count);
+        return;
+    }
+
+    const size_t range_size = (count + range_count - 1) / range_count;
+    std::atomic<size_t> remaining_ranges = range_count - 1;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 1; i < range_count; ++i) {
+            const size_t begin = i * range_size;
+            const size_t end = std::min(begin + range_size, count);
+
+            m_tasks.emplace_back([&func, &remaining_ranges, begin, end]() {
+                func(begin, end);
+                remaining_ranges.fetch_sub(1, std::memory_order_release);
+            });
+        }
+    }
+    m_condition.notify_all();
+
+    func(0, std::min(range_size, count));
+
+    while (remaining_ranges.load(std::memory_order_acquire) > 0) {
+        if (!_try_run_task()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+size_t thread_pool::get_worker_count() const noexcept {
+    return m_workers.size();
+}
+
+void thread_pool::_worker_loop() noexcept {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_is_stopped || !m_tasks.empty(); });
+
+            if (m_is_stopped && m_tasks.empty()) {
+                return;
+            }
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+
+        task();
+    }
+}
+
+bool thread_pool::_try_run_task() noexcept {
+    std::function<void()> task;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_tasks.empty()) {
+            return false;
+        }
+
+        task = std::move(m_tasks.front());
+        m_tasks.pop_front();
+    }
+
+    task();
+    return true;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <deque>
+#include <vector>
+
+#include "nocopyable.hpp"
+
+class thread_pool : public nocopyable {
+public:
+    thread_pool() = default;
+    thread_pool(size_t worker_count);
+    ~thread_pool();
+
+    void create(size_t worker_count) noexcept;
+    void destroy() noexcept;
+
+    // Splits [0, count) into ranges of at least grain_size elements and calls func(begin, end) for each of them.
+    // The calling thread executes queued tasks while waiting, so nested calls from inside of func are allowed
+    void parallel_for(size_t count, size_t grain_size, const std::function<void(size_t, size_t)>& func) noexcept;
+
+    size_t get_worker_count() const noexcept;
+
+private:
+    void _worker_loop() noexcept;
+    bool _try_run_task() noexcept;
+
+private:
+    std::vector<std::thread> m_workers;
+    std::deque<std::function<void()>> m_tasks;
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+
+    bool m_is_stopped = false;
+};
+
+
+// Same as thread_pool::parallel_for but runs func(0, count) on the calling thread if pool is nullptr
+template <typename Func>
+inline void parallel_for(thread_pool* pool, size_t count, size_t grain_size, const Func& func) noexcept {
+    if (pool != nullptr) {
+        pool->parallel_for(count, grain_size, func);
+    } else {
+        func(0, count);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,186 @@
+#include "vector_field.hpp"
+
+#include "debug.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+vector_field::vector_field(const std::string& filepath) {
+    load(filepath);
+}
+
+vector_field::vector_field(const glm::uvec3& resolution, const glm::vec3& min, const glm::vec3& max, const generator& generator) {
+    create(resolution, min, max, generator);
+}
+
+void vector_field::load(const std::string& filepath) noexcept {
+    std::ifstream file(filepath);
+    ASSERT(file.is_open(), "vector_field", "couldn't open file \"" + filepath + "\"");
+
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::replace(content.begin(), content.end(), ',', ' ');
+
+    std::istringstream stream(content);
+
+    stream >> m_resolution.x >> m_resolution.y >> m_resolution.z;
+    stream >> m_min.x >> m_min.y >> m_min.z;
+    stream >> m_max.x >> m_max.y >> m_max.z;
+    ASSERT(stream && m_resolution.x > 0 && m_resolution.y > 0 && m_resolution.z > 0, "vector_field", "invalid header in \"" + filepath + "\"");
+
+    m_vectors.resize(size_t(m_resolution.x) * m_resolution.y * m_resolution.z);
+    for (glm::vec3& vector : m_vectors) {
+        stream >> vector.x >> vector.y >> vector.z;
+    }
+    ASSERT(stream, "vector_field", "not enough vectors in \"" + filepath + "\"");
+
+    _update_mapping();
+}
+
+void vector_field::create(const glm::uvec3& resolution, const glm::vec3& min, const glm::vec3& max, const generator& generator) noexcept {
+    ASSERT(resolution.x > 0 && resolution.y > 0 && resolution.z > 0, "vector_field", "invalid resolution");
+
+    m_resolution = resolution;
+    m_min = min;
+    m_max = max;
+    _update_mapping();
+
+    m_vectors.resize(size_t(m_resolution.x) * m_resolution.y * m_resolution.z);
+
+    const glm::vec3 grid_to_world = (m_max - m_min) / glm::max(glm::vec3(m_resolution) - 1.0f, glm::vec3(1.0f));
+
+    size_t index = 0;
+    for (uint32_t z = 0; z < m_resolution.z; ++z) {
+        for (uint32_t y = 0; y < m_resolution.y; ++y) {
+            for (uint32_t x = 0; x < m_resolution.x; ++x) {
+                m_vectors[index++] = generator(m_min + glm::vec3(x, y, z) * grid_to_world);
+            }
+        }
+    }
+}
+
+glm::vec3 vector_field::sample(const glm::vec3& position) const noexcept {
+    glm::vec3 result(0.0f);
+    accumulate(&position.x, &position.y, &position.z, 1, 1.0f, &result.x, &result.y, &result.z);
+    return result;
+}
+
+void vector_field::accumulate(const float* x, const float* y, const float* z, size_t count, float scale, float* out_x, float* out_y, float* out_z) const noexcept {
+    if (m_vectors.empty()) {
+        return;
+    }
+
+    const size_t stride_y = m_resolution.x;
+    const size_t stride_z = size_t(m_resolution.x) * m_resolution.y;
+
+    // NOTE: the last cell is used for coordinates on the max border, so that +1 neighbours are always valid
+    const glm::uvec3 max_cell = glm::max(m_resolution, glm::uvec3(2)) - 2u;
+    const glm::uvec3 step(m_resolution.x > 1 ? 1 : 0, m_resolution.y > 1 ? stride_y : 0, m_resolution.z > 1 ? stride_z : 0);
+
+    const size_t corner_offsets[8] = { 
+        0, step.x, step.y, step.y + step.x, 
+        step.z, step.z + step.x, step.z + step.y, step.z + step.y + step.x 
+    };
+
+    const simd::type min_x_v = simd::set(m_min.x), min_y_v = simd::set(m_min.y), min_z_v = simd::set(m_min.z);
+    const simd::type world_to_grid_x_v = simd::set(m_world_to_grid.x);
+    const simd::type world_to_grid_y_v = simd::set(m_world_to_grid.y);
+    const simd::type world_to_grid_z_v = simd::set(m_world_to_grid.z);
+    const simd::type max_grid_x_v = simd::set(m_max_grid_coord.x);
+    const simd::type max_grid_y_v = simd::set(m_max_grid_coord.y);
+    const simd::type max_grid_z_v = simd::set(m_max_grid_coord.z);
+    const simd::type max_cell_x_v = simd::set(float(max_cell.x));
+    const simd::type max_cell_y_v = simd::set(float(max_cell.y));
+    const simd::type max_cell_z_v = simd::set(float(max_cell.z));
+    const simd::type zero_v = simd::set(0.0f);
+    const simd::type scale_v = simd::set(scale);
+
+    // NOTE: cells and weights of WIDTH particles are computed at once, only the corner loads are scalar.
+    // Corners are transposed into SoA lanes, so that the trilinear blend is vectorized too
+    size_t i = 0;
+    for (; i + simd::WIDTH <= count; i += simd::WIDTH) {
+        const simd::type gx = simd::min(simd::max(simd::mul(simd::sub(simd::load(x + i), min_x_v), world_to_grid_x_v), zero_v), max_grid_x_v);
+        const simd::type gy = simd::min(simd::max(simd::mul(simd::sub(simd::load(y + i), min_y_v), world_to_grid_y_v), zero_v), max_grid_y_v);
+        const simd::type gz = simd::min(simd::max(simd::mul(simd::sub(simd::load(z + i), min_z_v), world_to_grid_z_v), zero_v), max_grid_z_v);
+
+        // NOTE: grid coordinates aren't negative, so truncation is floor
+        const simd::type cx = simd::min(simd::to_float(simd::to_int(gx)), max_cell_x_v);
+        const simd::type cy = simd::min(simd::to_float(simd::to_int(gy)), max_cell_y_v);
+        const simd::type cz = simd::min(simd::to_float(simd::to_int(gz)), max_cell_z_v);
+
+        const simd::type tx = simd::sub(gx, cx), ty = simd::sub(gy, cy), tz = simd::sub(gz, cz);
+
+        int32_t cells[3][simd::WIDTH];
+        simd::istore(cells[0], simd::to_int(cx));
+        simd::istore(cells[1], simd::to_int(cy));
+        simd::istore(cells[2], simd::to_int(cz));
+
+        float corners[8][3][simd::WIDTH];
+        for (size_t lane = 0; lane < simd::WIDTH; ++lane) {
+            const glm::vec3* v = m_vectors.data() + cells[0][lane] + cells[1][lane] * stride_y + cells[2][lane] * stride_z;
+            for (size_t corner = 0; corner < 8; ++corner) {
+                const glm::vec3& value = v[corner_offsets[corner]];
+                corners[corner][0][lane] = value.x;
+                corners[corner][1][lane] = value.y;
+                corners[corner][2][lane] = value.z;
+            }
+        }
+
+        float* const out[3] = { out_x + i, out_y + i, out_z + i };
+        for (size_t axis = 0; axis < 3; ++axis) {
+            const simd::type v00 = simd::lerp(simd::load(corners[0][axis]), simd::load(corners[1][axis]), tx);
+            const simd::type v10 = simd::lerp(simd::load(corners[2][axis]), simd::load(corners[3][axis]), tx);
+            const simd::type v01 = simd::lerp(simd::load(corners[4][axis]), simd::load(corners[5][axis]), tx);
+            const simd::type v11 = simd::lerp(simd::load(corners[6][axis]), simd::load(corners[7][axis]), tx);
+
+            const simd::type value = simd::lerp(simd::lerp(v00, v10, ty), simd::lerp(v01, v11, ty), tz);
+            simd::store(out[axis], simd::add(simd::load(out[axis]), simd::mul(value, scale_v)));
+        }
+    }
+
+    for (; i < count; ++i) {
+        const float gx = std::clamp((x[i] - m_min.x) * m_world_to_grid.x, 0.0f, m_max_grid_coord.x);
+        const float gy = std::clamp((y[i] - m_min.y) * m_world_to_grid.y, 0.0f, m_max_grid_coord.y);
+        const float gz = std::clamp((z[i] - m_min.z) * m_world_to_grid.z, 0.0f, m_max_grid_coord.z);
+
+        const uint32_t cx = std::min(static_cast<uint32_t>(gx), max_cell.x);
+        const uint32_t cy = std::min(static_cast<uint32_t>(gy), max_cell.y);
+        const uint32_t cz = std::min(static_cast<uint32_t>(gz), max_cell.z);
+
+        const float tx = gx - cx, ty = gy - cy, tz = gz - cz;
+
+        const glm::vec3* v = m_vectors.data() + cx + cy * stride_y + cz * stride_z;
+
+        const glm::vec3 v00 = glm::mix(v[0],                 v[step.x],                   tx);
+        const glm::vec3 v10 = glm::mix(v[step.y],            v[step.y + step.x],          tx);
+        const glm::vec3 v01 = glm::mix(v[step.z],            v[step.z + step.x],          tx);
+        const glm::vec3 v11 = glm::mix(v[step.z + step.y],   v[step.z + step.y + step.x], tx);
+
+        const glm::vec3 value = glm::mix(glm::mix(v00, v10, ty), glm::mix(v01, v11, ty), tz) * scale;
+
+        out_x[i] += value.x;
+        out_y[i] += value.y;
+        out_z[i] += value.z;
+    }
+}
+
+const glm::uvec3& vector_field::get_resolution() const noexcept {
+    return m_resolution;
+}
+
+const glm::vec3& vector_field::get_min() const noexcept {
+    return m_min;
+}
+
+const glm::vec3& vector_field::get_max() const noexcept {
+    return m_max;
+}
+
+void vector_field::_update_mapping() noexcept {
+    const glm::vec3 size = m_max - m_min;
+    ASSERT(size.x > 0.0f && size.y > 0.0f && size.z > 0.0f, "vector_field", "invalid bounds");
+
+    m_max_grid_coord = glm::vec3(m_resolution) - 1.0f;
+    m_world_to_grid = m_max_grid_coord / size;
+}
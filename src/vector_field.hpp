@@ -0,0 +1,45 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// 3D grid of vectors over [min, max] box sampled with trilinear filtering. Positions outside of the box are clamped to it
+class vector_field {
+public:
+    using generator = std::function<glm::vec3(const glm::vec3& position)>;
+
+public:
+    vector_field() = default;
+    vector_field(const std::string& filepath);
+    vector_field(const glm::uvec3& resolution, const glm::vec3& min, const glm::vec3& max, const generator& generator);
+
+    // Loads .fga file: "X,Y,Z," resolution, "x,y,z," min and max bounds, then X*Y*Z "x,y,z," vectors with X changing fastest
+    void load(const std::string& filepath) noexcept;
+    // Fills the grid with generator values taken at grid points
+    void create(const glm::uvec3& resolution, const glm::vec3& min, const glm::vec3& max, const generator& generator) noexcept;
+
+    glm::vec3 sample(const glm::vec3& position) const noexcept;
+
+    // Batch version of sample() over SoA streams: out += sample(position) * scale for count positions
+    void accumulate(const float* x, const float* y, const float* z, size_t count, float scale, float* out_x, float* out_y, float* out_z) const noexcept;
+
+    const glm::uvec3& get_resolution() const noexcept;
+    const glm::vec3& get_min() const noexcept;
+    const glm::vec3& get_max() const noexcept;
+
+private:
+    void _update_mapping() noexcept;
+
+private:
+    std::vector<glm::vec3> m_vectors;
+
+    glm::uvec3 m_resolution = glm::uvec3(0);
+    glm::vec3 m_min = glm::vec3(0.0f);
+    glm::vec3 m_max = glm::vec3(0.0f);
+
+    // NOTE: maps world position into grid coordinates: (position - min) * m_world_to_grid
+    glm::vec3 m_world_to_grid = glm::vec3(0.0f);
+    glm::vec3 m_max_grid_coord = glm::vec3(0.0f);
+};
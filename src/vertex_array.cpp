@@ -18,6 +18,10 @@ void vertex_array::create() noexcept {
 }
 
 void vertex_array::destroy() noexcept {
+    if (m_id == 0) {
+        return;
+    }
+
     OGL_CALL(glDeleteVertexArrays(1, &m_id));
     
     m_id = 0;
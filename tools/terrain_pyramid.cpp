@@ -0,0 +1,80 @@
+// Builds terrain_pyramid file for terrain_streamer from any height map terrain::create() accepts. Doesn't create window or OpenGL context.
+//
+// terrain_pyramid <height map> <output> [--raw-width N] [--threads N]
+
+#include "terrain_pyramid.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
+namespace {
+    struct pyramid_settings {
+        std::string height_map_path;
+        std::string output_path;
+        int32_t raw_width = 0;
+        size_t thread_count = 0;
+    };
+
+    bool parse_settings(int argc, char* argv[], pyramid_settings& settings) noexcept {
+        for (int i = 1; i < argc; ++i) {
+            const bool has_value = i + 1 < argc;
+
+            if (strcmp(argv[i], "--raw-width") == 0 && has_value) {
+                settings.raw_width = std::atoi(argv[++i]);
+            } else if (strcmp(argv[i], "--threads") == 0 && has_value) {
+                settings.thread_count = std::strtoull(argv[++i], nullptr, 10);
+            } else if (argv[i][0] != '-' && settings.height_map_path.empty()) {
+                settings.height_map_path = argv[i];
+            } else if (argv[i][0] != '-' && settings.output_path.empty()) {
+                settings.output_path = argv[i];
+            } else {
+                fprintf(stderr, "unknown argument: %s\n", argv[i]);
+                return false;
+            }
+        }
+
+        return !settings.height_map_path.empty() && !settings.output_path.empty();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    pyramid_settings settings;
+    if (!parse_settings(argc, argv, settings)) {
+        fprintf(stderr, "usage: terrain_pyramid <height map> <output> [--raw-width N] [--threads N]\n");
+        return EXIT_FAILURE;
+    }
+
+    std::unique_ptr<thread_pool> pool;
+    if (settings.thread_count > 0) {
+        pool = std::make_unique<thread_pool>(settings.thread_count);
+    }
+
+    const auto start_time = std::chrono::steady_clock::now();
+
+    terrain source;
+    // NOTE: raw height maps stay memory-mapped, the pyramid is built from one pass over their rows
+    source.load_samples(settings.height_map_path, pool.get(), settings.raw_width);
+    if (source.width == 0 || source.depth == 0) {
+        fprintf(stderr, "couldn't load height map \"%s\"\n", settings.height_map_path.c_str());
+        return EXIT_FAILURE;
+    }
+
+    const auto load_time = std::chrono::steady_clock::now();
+
+    if (!terrain_pyramid::write(settings.output_path, source, pool.get())) {
+        fprintf(stderr, "couldn't write \"%s\"\n", settings.output_path.c_str());
+        return EXIT_FAILURE;
+    }
+
+    const auto end_time = std::chrono::steady_clock::now();
+
+    printf("%dx%d heights, %d levels, load %.1f ms, build %.1f ms\n", source.width, source.depth, source.get_lod_count(),
+        std::chrono::duration<double, std::milli>(load_time - start_time).count(),
+        std::chrono::duration<double, std::milli>(end_time - load_time).count());
+
+    return EXIT_SUCCESS;
+}